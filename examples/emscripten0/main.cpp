@@ -28,6 +28,7 @@ extern "C" {
             ImGui::Render();
 
             ImTui_ImplText_RenderDrawData(ImGui::GetDrawData(), g_screen);
+            ImTui_ImplEmscripten_DrawScreen();
         }
 }
 
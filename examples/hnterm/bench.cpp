@@ -0,0 +1,182 @@
+/*! \file bench.cpp
+ *  \brief Fetch pipeline benchmark against the local mock API server
+ */
+
+#include "hn-state.h"
+#include "mock-server.h"
+
+#include <map>
+
+extern bool hnInit(const char * cacheFname, int maxParallel);
+extern void hnFree();
+
+namespace {
+
+std::map<std::string, std::string> parseCmdArguments(int argc, char ** argv) {
+    std::map<std::string, std::string> res;
+    for (int i = 1; i < argc; ++i) {
+        res[argv[i]] = "";
+        if (argv[i][0] == '-' && strlen(argv[i]) > 1) {
+            res[std::string(1, argv[i][1])] = strlen(argv[i]) > 2 ? argv[i] + 2 : "";
+        }
+    }
+
+    return res;
+}
+
+float t_ms(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool isLoaded(const HN::State & state, HN::ItemId id) {
+    const HN::Item * item = state.findItem(id);
+    return item && item->type != HN::ItemType::Unknown;
+}
+
+}
+
+// Opens the front page and then the whole comment thread of the top story, the way the UI requests them, and
+// reports how long it took and how much was transferred.
+int main(int argc, char ** argv) {
+    auto argm = parseCmdArguments(argc, argv);
+    if (argm.find("--help") != argm.end() || argm.find("h") != argm.end()) {
+        printf("Usage: hnterm-bench [-sN] [-tN] [-lN] [-bN] [-kN] [-eN] [-dN] [-pN] [-cFILE] [-h]\n");
+        printf("    -sN    : number of stories (default: 500)\n");
+        printf("    -tN    : max number of comments of a story - the top story has 2*N (default: 200)\n");
+        printf("    -lN    : latency of each response in ms (default: 50)\n");
+        printf("    -bN    : bandwidth per connection in KB/s (default: unlimited)\n");
+        printf("    -kN    : send the bodies chunked, in pieces of N bytes (default: not chunked)\n");
+        printf("    -eN    : respond with an error to N out of 1000 requests (default: 0)\n");
+        printf("    -dN    : drop the connection on N out of 1000 requests (default: 0)\n");
+        printf("    -pN    : run at most N requests in parallel (default: hnterm's default)\n");
+        printf("    -cFILE : item cache file (default: none)\n");
+        printf("    -h     : print this help\n");
+        return -1;
+    }
+
+    MockServer::Config config;
+    config.latency_ms = 50;
+
+    int maxParallel = 0;
+    int nFrontPage = 30;
+
+    auto arg = [&](const char * name, int & val) {
+        if (argm.find(name) != argm.end() && argm[name].empty() == false) {
+            val = atoi(argm[name].c_str());
+        }
+    };
+
+    arg("s", config.nStories);
+    arg("t", config.maxThreadSize);
+    arg("l", config.latency_ms);
+    arg("b", config.bandwidth_KBps);
+    arg("k", config.chunkSize);
+    arg("e", config.errorsPerMille);
+    arg("d", config.dropsPerMille);
+    arg("p", maxParallel);
+
+    const std::string cacheFname = argm.find("c") != argm.end() ? argm["c"] : "";
+
+    MockServer server;
+    if (server.start(config) == false) {
+        fprintf(stderr, "Failed to start the mock server\n");
+        return -1;
+    }
+
+    HN::setAPIBase(server.baseURI());
+    if (hnInit(cacheFname.empty() ? nullptr : cacheFname.c_str(), maxParallel) == false) {
+        fprintf(stderr, "Failed to initialize\n");
+        return -1;
+    }
+
+    HN::State state;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    const float kTimeout_ms = 120000.0f;
+
+    float tFirstStory_ms = -1.0f;
+    float tFrontPage_ms = -1.0f;
+    float tFullThread_ms = -1.0f;
+
+    uint64_t nBytesFrontPage = 0;
+
+    HN::ItemIds visible;
+    HN::ItemIds thread;
+    int maxDepth = 0;
+
+    // front page
+    while (tFrontPage_ms < 0.0f && t_ms(t0) < kTimeout_ms) {
+        visible.assign(state.idsTop.begin(), state.idsTop.begin() + std::min<size_t>(nFrontPage, state.idsTop.size()));
+
+        state.update(visible, {});
+
+        if (tFirstStory_ms < 0.0f && visible.empty() == false && isLoaded(state, visible[0])) {
+            tFirstStory_ms = t_ms(t0);
+        }
+
+        if (visible.empty() == false && std::all_of(visible.begin(), visible.end(), [&](auto id) { return isLoaded(state, id); })) {
+            tFrontPage_ms = t_ms(t0);
+            nBytesFrontPage = state.totalBytesDownloaded;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // the thread of the top story - the kids of every received comment are requested right away
+    const auto t1 = std::chrono::steady_clock::now();
+    const HN::ItemId storyId = state.idsTop.empty() ? 0 : state.idsTop[0];
+    while (storyId != 0 && tFullThread_ms < 0.0f && t_ms(t0) < kTimeout_ms) {
+        HN::ItemIds toRefresh;
+
+        thread.clear();
+        std::vector<std::pair<HN::ItemId, int>> stack = { { storyId, 0 } };
+        while (stack.empty() == false) {
+            const auto [id, depth] = stack.back();
+            stack.pop_back();
+
+            thread.push_back(id);
+            maxDepth = std::max(maxDepth, depth);
+
+            const HN::Item * item = state.findItem(id);
+            HN::Kids kids;
+            if (item && item->type == HN::ItemType::Story) {
+                kids = state.getStory(*item).kids;
+            } else if (item && item->type == HN::ItemType::Comment) {
+                kids = state.getComment(*item).kids;
+            } else {
+                toRefresh.push_back(id);
+            }
+
+            for (size_t i = kids.size(); i > 0; --i) {
+                stack.push_back({ kids[i - 1], depth + 1 });
+            }
+        }
+
+        state.update(toRefresh, {});
+
+        if (toRefresh.empty()) {
+            tFullThread_ms = t_ms(t1);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    hnFree();
+    server.stop();
+
+    const auto & stats = state.endpointStats[(int) HN::Endpoint::Items];
+
+    printf("Mock server        : %d stories, %d ms latency, %d KB/s, chunks of %d B, %d/%d errors/drops per 1000\n",
+           config.nStories, config.latency_ms, config.bandwidth_KBps, config.chunkSize, config.errorsPerMille, config.dropsPerMille);
+    printf("Time to first story: %8.1f ms\n", tFirstStory_ms);
+    printf("Time to front page : %8.1f ms (%d stories, %d B)\n", tFrontPage_ms, nFrontPage, (int) nBytesFrontPage);
+    printf("Time to full thread: %8.1f ms (%d items, depth %d)\n", tFullThread_ms, (int) thread.size(), maxDepth);
+    printf("API requests       : %d (+%d merged, %d cached), %d served, %d not modified, %d failed\n",
+           state.nFetches, state.nMerged, state.nCacheHits, (int) server.nRequests, (int) server.nNotModified, (int) server.nErrors);
+    printf("Bytes received     : %d B (item bodies: %d B received, %d B decoded)\n",
+           (int) state.totalBytesDownloaded, (int) stats.nBytesReceived, (int) stats.nBytesDecoded);
+    printf("Bytes sent         : %d B\n", (int) server.nBytesSent);
+    printf("Items in memory    : %d (%d KB)\n", (int) state.nItems(), (int) (state.memoryUsage()/1024));
+
+    return (tFirstStory_ms < 0.0f || tFrontPage_ms < 0.0f || tFullThread_ms < 0.0f) ? 1 : 0;
+}
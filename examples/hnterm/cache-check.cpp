@@ -0,0 +1,78 @@
+/*! \file cache-check.cpp
+ *  \brief Checks that the item cache compacts logs made of expired records and keeps the fresh ones
+ */
+
+#include "item-cache.h"
+
+#include <cstdlib>
+
+namespace {
+
+int64_t now_s() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// unique URIs, like the HN items - only the age of the records differs
+void fill(const std::string & fname, int64_t t_s, uint64_t nBytes) {
+    ItemCache cache;
+    if (cache.open(fname) == false) {
+        fprintf(stderr, "Failed to open '%s'\n", fname.c_str());
+        exit(1);
+    }
+
+    const std::string body(1024, 'x');
+    for (uint64_t i = 0; i*body.size() < nBytes; ++i) {
+        cache.put("v0/item/" + std::to_string(i) + ".json", "", body, t_s);
+    }
+}
+
+// reopen the log and give the writer thread time to compact it
+uint64_t sizeAfterReopen(const std::string & fname, int & nEntries) {
+    ItemCache cache;
+    cache.open(fname);
+
+    const auto tStart = std::chrono::steady_clock::now();
+    while (cache.fileSize() > ItemCache::kCompactBytes && std::chrono::steady_clock::now() - tStart < std::chrono::seconds(3)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    nEntries = cache.nEntries();
+
+    return cache.fileSize();
+}
+
+}
+
+int main(int argc, char ** argv) {
+#ifndef HNTERM_ITEM_CACHE
+    (void) argc; (void) argv;
+    printf("The item cache is not supported on this platform\n");
+    return 0;
+#else
+    const std::string fname = argc > 1 ? argv[1] : "hnterm-cache-check.bin";
+    const uint64_t nBytes = 2*ItemCache::kCompactBytes;
+
+    int nFailed = 0;
+    auto check = [&](bool isOk, const char * what) {
+        printf("%s : %s\n", isOk ? "ok    " : "FAILED", what);
+        nFailed += isOk ? 0 : 1;
+    };
+
+    int nEntries = 0;
+
+    unlink(fname.c_str());
+    fill(fname, now_s() - ItemCache::kMaxAge_s - 3600, nBytes);
+    const uint64_t sizeStale = sizeAfterReopen(fname, nEntries);
+    // the writer can compact while the log is being filled - then the rest stays below kCompactBytes
+    check(sizeStale < ItemCache::kCompactBytes, "a log of only expired records is compacted");
+
+    unlink(fname.c_str());
+    fill(fname, now_s(), nBytes);
+    const uint64_t sizeFresh = sizeAfterReopen(fname, nEntries);
+    check(sizeFresh >= nBytes && nEntries > 0, "a log of fresh records is kept");
+
+    unlink(fname.c_str());
+
+    return nFailed == 0 ? 0 : 1;
+#endif
+}
@@ -4,247 +4,258 @@
 
 #include "hn-state.h"
 
+#include "html.h"
 #include "json.h"
 
-extern void requestJSONForURI_impl(std::string uri);
-extern std::string getJSONForURI_impl(const std::string & uri);
+#include <chrono>
+
+extern void requestJSONForURI_impl(std::string uri, HN::Priority priority);
+extern void prioritizeRequest_impl(std::string uri, HN::Priority priority);
+extern void cancelRequest_impl(std::string uri);
+extern bool pollResponse_impl(HN::Response & res);
 extern uint64_t getTotalBytesDownloaded();
 extern int getNFetches();
+extern int getNMerged();
+extern int getNCacheHits();
+extern void getEndpointStats_impl(HN::EndpointStatsArray & res);
 extern void updateRequests_impl();
 extern uint64_t t_s();
 
-namespace {
+namespace HN {
 
-    void replaceAll(std::string & s, const std::string & search, const std::string & replace) {
-        for (size_t pos = 0; ; pos += replace.length()) {
-            pos = s.find(search, pos);
-            if (pos == std::string::npos) break;
-            s.erase(pos, search.length());
-            s.insert(pos, replace);
-        }
+    URI kAPIItem        = kAPIBaseDefault + "/v0/item/";
+    URI kAPITopStories  = kAPIBaseDefault + "/v0/topstories.json";
+    URI kAPINewStories  = kAPIBaseDefault + "/v0/newstories.json";
+    //URI kAPIBestStories = kAPIBaseDefault + "/v0/beststories.json";
+    URI kAPIAskStories  = kAPIBaseDefault + "/v0/askstories.json";
+    URI kAPIShowStories = kAPIBaseDefault + "/v0/showstories.json";
+    URI kAPIJobStories  = kAPIBaseDefault + "/v0/jobstories.json";
+    URI kAPIUpdates     = kAPIBaseDefault + "/v0/updates.json";
+
+    void setAPIBase(const URI & base) {
+        kAPIItem        = base + "/v0/item/";
+        kAPITopStories  = base + "/v0/topstories.json";
+        kAPINewStories  = base + "/v0/newstories.json";
+        //kAPIBestStories = base + "/v0/beststories.json";
+        kAPIAskStories  = base + "/v0/askstories.json";
+        kAPIShowStories = base + "/v0/showstories.json";
+        kAPIJobStories  = base + "/v0/jobstories.json";
+        kAPIUpdates     = base + "/v0/updates.json";
     }
 
-    std::string getJSONForURI(const std::string & uri) {
-        auto responseString = getJSONForURI_impl(uri);
-        if (responseString == "") return "";
+    URI getItemURI(ItemId id) {
+        return kAPIItem + std::to_string(id) + ".json";
+    }
 
-        return responseString;
+    // the members of an item object, as they appear in the response
+    struct ItemFields {
+        std::string_view type;
+        std::string_view by;
+        std::string_view descendants;
+        std::string_view id;
+        std::string_view kids;
+        std::string_view parent;
+        std::string_view score;
+        std::string_view time;
+        std::string_view text;
+        std::string_view title;
+        std::string_view url;
+    };
+
+    bool parseItemFields(std::string_view json, ItemFields & res) {
+        return JSON::forEachMember(json, [&](std::string_view key, std::string_view val) {
+            if      (key == "type")        res.type        = val;
+            else if (key == "by")          res.by          = val;
+            else if (key == "descendants") res.descendants = val;
+            else if (key == "id")          res.id          = val;
+            else if (key == "kids")        res.kids        = val;
+            else if (key == "parent")      res.parent      = val;
+            else if (key == "score")       res.score       = val;
+            else if (key == "time")        res.time        = val;
+            else if (key == "text")        res.text        = val;
+            else if (key == "title")       res.title       = val;
+            else if (key == "url")         res.url         = val;
+        });
     }
 
-}
+    ItemType getItemType(std::string_view type) {
+        if (type == "story") return ItemType::Story;
+        if (type == "comment") return ItemType::Comment;
+        if (type == "job") return ItemType::Job;
+        if (type == "poll") return ItemType::Poll;
+        if (type == "pollopt") return ItemType::PollOpt;
 
-namespace HN {
+        return ItemType::Unknown;
+    }
 
-    // todo : optimize this
-    std::string parseHTML(std::string str) {
-        ::replaceAll(str, "<p>", "\n");
+    void parseBy(std::string_view by, std::string & res) {
+        res.clear();
+        if (by.empty()) {
+            res = "[deleted]";
+            return;
+        }
+        JSON::unescape(by, res);
+    }
 
+    std::string parseText(std::string_view text) {
         std::string res;
-        bool inTag = false;
-        for (auto & ch : str) {
-            if (ch == '<') {
-                inTag = true;
-            } else if (ch == '>') {
-                inTag = false;
-            } else {
-                if (inTag == false) {
-                    res += ch;
-                }
-            }
+        if (text.find('\\') == std::string_view::npos) {
+            HTML::decode(text, res);
+            return res;
         }
 
-        ::replaceAll(res, "&#x2F;", "/");
-        ::replaceAll(res, "&#x27;", "'");
-        ::replaceAll(res, "&gt;", ">");
-        ::replaceAll(res, "–", "-");
-        ::replaceAll(res, "“", "\"");
-        ::replaceAll(res, "”", "\"");
-        ::replaceAll(res, "‘", "'");
-        ::replaceAll(res, "’", "'");
-        ::replaceAll(res, "„", "'");
-        ::replaceAll(res, "&quot;", "\"");
-        ::replaceAll(res, "&amp;", "&");
-        ::replaceAll(res, "—", "-");
+        std::string unescaped;
+        JSON::unescape(text, unescaped);
+        HTML::decode(unescaped, res);
 
         return res;
     }
 
-    URI getItemURI(ItemId id) {
-        return kAPIItem + std::to_string(id) + ".json";
-    }
+    void parseURL(std::string_view url, std::string & res, std::string & domain) {
+        res.clear();
+        JSON::unescape(url, res);
 
-    ItemType getItemType(const ItemData & itemData) {
-        if (itemData.find("type") == itemData.end()) return ItemType::Unknown;
+        domain.clear();
+        int slash = 0;
+        for (auto & ch : res) {
+            if (ch == '/') {
+                ++slash;
+                continue;
+            }
+            if (slash > 2) break;
+            if (slash > 1) domain += ch;
+        }
+    }
 
-        auto strType = itemData.at("type");
+    void parseStory(const ItemFields & data, Story & res) {
+        parseBy(data.by, res.by);
+        res.descendants = JSON::toInt(data.descendants, 0);
+        res.id          = JSON::toInt(data.id, 0);
+        res.kids        = JSON::parseIntArray(data.kids);
+        res.score       = JSON::toInt(data.score, 0);
+        res.time        = JSON::toInt<uint64_t>(data.time, 0);
+        res.text        = parseText(data.text);
+        res.title       = parseText(data.title);
+        parseURL(data.url, res.url, res.domain);
+    }
 
-        if (strType == "story") return ItemType::Story;
-        if (strType == "comment") return ItemType::Comment;
-        if (strType == "job") return ItemType::Job;
-        if (strType == "poll") return ItemType::Poll;
-        if (strType == "pollopt") return ItemType::PollOpt;
+    void parseComment(const ItemFields & data, Comment & res) {
+        parseBy(data.by, res.by);
+        res.id     = JSON::toInt(data.id, 0);
+        res.kids   = JSON::parseIntArray(data.kids);
+        res.parent = JSON::toInt(data.parent, 0);
+        res.text   = parseText(data.text);
+        res.time   = JSON::toInt<uint64_t>(data.time, 0);
+    }
 
-        return ItemType::Unknown;
+    void parseJob(const ItemFields & data, Job & res) {
+        parseBy(data.by, res.by);
+        res.id    = JSON::toInt(data.id, 0);
+        res.score = JSON::toInt(data.score, 0);
+        res.time  = JSON::toInt<uint64_t>(data.time, 0);
+        res.title = parseText(data.title);
+        parseURL(data.url, res.url, res.domain);
     }
 
-    void parseStory(const ItemData & data, Story & res) {
-        try {
-            res.by = data.at("by");
-        } catch (...) {
-            res.by = "[deleted]";
-        }
-        try {
-            res.descendants = std::stoi(data.at("descendants"));
-        } catch (...) {
-            res.descendants = 0;
-        }
-        try {
-            res.id = std::stoi(data.at("id"));
-        } catch (...) {
-            res.id = 0;
-        }
-        try {
-            res.kids = JSON::parseIntArray(data.at("kids"));
-        } catch (...) {
-            res.kids.clear();
-        }
-        try {
-            res.score = std::stoi(data.at("score"));
-        } catch (...) {
-            res.score = 0;
-        }
-        try {
-            res.time = std::stoll(data.at("time"));
-        } catch (...) {
-            res.time = 0;
-        }
-        try {
-            res.text = parseHTML(data.at("text"));
-        } catch (...) {
-            res.text = "";
-        }
-        try {
-            res.title = parseHTML(data.at("title"));
-        } catch (...) {
-            res.title = "";
-        }
-        try {
-            res.url = data.at("url");
-            res.domain = "";
-            int slash = 0;
-            for (auto & ch : res.url) {
-                if (ch == '/') {
-                    ++slash;
-                    continue;
+    Response parseResponse(URI uri, std::string_view json) {
+        Response res;
+        res.uri = std::move(uri);
+
+        if (res.uri.compare(0, kAPIItem.size(), kAPIItem) == 0) {
+            // the id is taken from the URI, because deleted items come back as "null"
+            const std::string_view name = std::string_view(res.uri).substr(kAPIItem.size());
+            res.id = JSON::toInt(name.substr(0, name.find('.')), 0);
+
+            // on malformed input, the fields that were parsed before the error are still used
+            ItemFields data;
+            parseItemFields(json, data);
+
+            res.type = getItemType(data.type);
+            switch (res.type) {
+                case ItemType::Story:
+                    {
+                        res.data = Story();
+                        parseStory(data, std::get<Story>(res.data));
+                    }
+                    break;
+                case ItemType::Comment:
+                    {
+                        res.data = Comment();
+                        parseComment(data, std::get<Comment>(res.data));
+                    }
+                    break;
+                case ItemType::Job:
+                    {
+                        res.data = Job();
+                        parseJob(data, std::get<Job>(res.data));
+                    }
+                    break;
+                case ItemType::Unknown:
+                case ItemType::Poll:
+                case ItemType::PollOpt:
+                    break;
+            };
+        } else if (res.uri == kAPIUpdates) {
+            JSON::forEachMember(json, [&](std::string_view key, std::string_view val) {
+                if (key == "items") {
+                    res.ids = JSON::parseIntArray(val);
                 }
-                if (slash > 2) break;
-                if (slash > 1) res.domain += ch;
-            }
-        } catch (...) {
-            res.url = "";
-            res.domain = "";
+            });
+        } else {
+            res.ids = JSON::parseIntArray(json);
         }
-    }
 
-    void parseComment(const ItemData & data, Comment & res) {
-        try {
-            res.by = data.at("by");
-        } catch (...) {
-            res.by = "[deleted]";
-        }
-        try {
-            res.id = std::stoi(data.at("id"));
-        } catch (...) {
-            res.id = 0;
-        }
-        try {
-            res.kids = JSON::parseIntArray(data.at("kids"));
-        } catch (...) {
-            res.kids.clear();
-        }
-        try {
-            res.parent = std::stoi(data.at("parent"));
-        } catch (...) {
-            res.parent = 0;
-        }
-        try {
-            res.text = parseHTML(data.at("text"));
-        } catch (...) {
-            res.text = "";
-        }
-        try {
-            res.time = std::stoll(data.at("time"));
-        } catch (...) {
-            res.time = 0;
-        }
+        return res;
     }
 
-    void parseJob(const ItemData & data, Job & res) {
-        try {
-            res.by = data.at("by");
-        } catch (...) {
-            res.by = "[deleted]";
-        }
-        try {
-            res.id = std::stoi(data.at("id"));
-        } catch (...) {
-            res.id = 0;
-        }
-        try {
-            res.score = std::stoi(data.at("score"));
-        } catch (...) {
-            res.score = 0;
-        }
-        try {
-            res.time = std::stoll(data.at("time"));
-        } catch (...) {
-            res.time = 0;
-        }
-        try {
-            res.title = parseHTML(data.at("title"));
-        } catch (...) {
-            res.title = "";
-        }
-        try {
-            res.url = data.at("url");
-            res.domain = "";
-            int slash = 0;
-            for (auto & ch : res.url) {
-                if (ch == '/') {
-                    ++slash;
-                    continue;
-                }
-                if (slash > 2) break;
-                if (slash > 1) res.domain += ch;
-            }
-        } catch (...) {
-            res.url = "";
-            res.domain = "";
-        }
+    Endpoint getEndpoint(const URI & uri) {
+        if (uri.compare(0, kAPIItem.size(), kAPIItem) == 0) return Endpoint::Items;
+        if (uri == kAPITopStories)  return Endpoint::TopStories;
+        if (uri == kAPINewStories)  return Endpoint::NewStories;
+        if (uri == kAPIAskStories)  return Endpoint::AskStories;
+        if (uri == kAPIShowStories) return Endpoint::ShowStories;
+        if (uri == kAPIUpdates)     return Endpoint::Updates;
+
+        return Endpoint::Other;
     }
 
-    ItemIds getStoriesIds(const URI & uri) {
-        return JSON::parseIntArray(getJSONForURI(uri));
+    void ResponseParser::begin(const URI & uri) {
+        isActive = uri.compare(0, kAPIItem.size(), kAPIItem) != 0 && uri != kAPIUpdates;
+        ids.reset();
     }
 
-    ItemIds getChangedItemsIds() {
-        auto data = JSON::parseJSONMap(getJSONForURI(HN::kAPIUpdates));
-        return JSON::parseIntArray(data["items"]);
+    void ResponseParser::feed(std::string_view chunk) {
+        if (isActive) {
+            ids.feed(chunk);
+        }
     }
 
+    bool ResponseParser::finish(URI uri, Response & res) {
+        if (isActive == false) {
+            return false;
+        }
+
+        res = {};
+        res.uri = std::move(uri);
+        res.ids = std::move(ids.res);
+
+        isActive = false;
+
+        return true;
+    }
 
-    bool State::update(const ItemIds & toRefresh) {
+    bool State::update(const ItemIds & toRefreshVisible, const ItemIds & toRefresh) {
         bool updated = false;
 
         auto now = ::t_s();
 
         if (timeout(now, lastUpdatePoll_s)) {
-            requestJSONForURI(HN::kAPITopStories);
-            //requestJSONForURI(HN::kAPIBestStories);
-            requestJSONForURI(HN::kAPIShowStories);
-            requestJSONForURI(HN::kAPIAskStories);
-            requestJSONForURI(HN::kAPINewStories);
-            requestJSONForURI(HN::kAPIUpdates);
+            requestJSONForURI(HN::kAPITopStories, Priority::Background);
+            //requestJSONForURI(HN::kAPIBestStories, Priority::Background);
+            requestJSONForURI(HN::kAPIShowStories, Priority::Background);
+            requestJSONForURI(HN::kAPIAskStories, Priority::Background);
+            requestJSONForURI(HN::kAPINewStories, Priority::Background);
+            requestJSONForURI(HN::kAPIUpdates, Priority::Background);
 
             lastUpdatePoll_s = ::t_s();
             updated = true;
@@ -252,126 +263,235 @@ namespace HN {
             nextUpdate = lastUpdatePoll_s + 30 - now;
         }
 
-        {
-            {
-                auto ids = HN::getStoriesIds(HN::kAPITopStories);
-                if (ids.empty() == false) {
-                    idsTop = std::move(ids);
-                    updated = true;
-                }
+        // items on screen are wanted first, the rest of the rendered items can wait
+        wanted.clear();
+        for (auto id : toRefresh)        wanted[id] = Priority::Prefetch;
+        for (auto id : toRefreshVisible) wanted[id] = Priority::Visible;
+
+        // cancel the requests for items that are not rendered anymore and move the rest to their new priority
+        for (auto it = pending.begin(); it != pending.end(); ) {
+            const auto w = wanted.find(it->first);
+            if (w == wanted.end()) {
+                cancelRequest_impl(getItemURI(it->first));
+                getItem(it->first).needRequest = true;
+                it = pending.erase(it);
+                continue;
             }
 
-            //{
-            //    auto ids = HN::getStoriesIds(HN::kAPIBestStories);
-            //    if (ids.empty() == false) {
-            //        idsBest = std::move(ids);
-            //    }
-            //}
-
-            {
-                auto ids = HN::getStoriesIds(HN::kAPIShowStories);
-                if (ids.empty() == false) {
-                    idsShow = std::move(ids);
-                    updated = true;
-                }
+            if (w->second != it->second) {
+                prioritizeRequest_impl(getItemURI(it->first), w->second);
+                it->second = w->second;
             }
+            ++it;
+        }
 
-            {
-                auto ids = HN::getStoriesIds(HN::kAPIAskStories);
-                if (ids.empty() == false) {
-                    idsAsk = std::move(ids);
-                    updated = true;
-                }
+        for (const auto * ids : { &toRefreshVisible, &toRefresh }) {
+            for (auto id : *ids) {
+                auto & item = getItem(id);
+                if (item.needRequest == false) continue;
+
+                const auto priority = wanted[id];
+                requestJSONForURI(getItemURI(id), priority);
+                item.needRequest = false;
+                pending[id] = priority;
+                updated = true;
             }
+        }
 
-            {
-                auto ids = HN::getStoriesIds(HN::kAPINewStories);
-                if (ids.empty() == false) {
-                    idsNew = std::move(ids);
-                    updated = true;
-                }
+        // apply the responses that have been parsed in the background, until the time budget runs out
+        // the rest stay in the queue and are picked up on the next frame
+        const auto tStart = std::chrono::steady_clock::now();
+
+        received.clear();
+
+        Response res;
+        while (pollResponse_impl(res)) {
+            apply(res);
+            updated = true;
+
+            if (std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - tStart).count() > updateBudget_ms) {
+                break;
             }
         }
 
-        {
-            auto ids = HN::getChangedItemsIds();
-            for (auto id : ids) {
-                if (items.find(id) == items.end()) continue;
-                items[id].needUpdate = true;
-                items[id].needRequest = true;
+        nFetches = getNFetches();
+        nMerged = getNMerged();
+        nCacheHits = getNCacheHits();
+        totalBytesDownloaded = getTotalBytesDownloaded();
+        getEndpointStats_impl(endpointStats);
+
+        if (texts.needCompact() || kids.needCompact()) {
+            compact();
+        }
+
+        updateRequests_impl();
+
+        return updated;
+    }
+
+    void State::forceUpdate(const ItemIds & toUpdate) {
+        auto tNow_s = t_s();
+        for (auto id : toUpdate) {
+            const uint32_t slot = index.find(id);
+            if (slot == ItemIndex::kNone) continue;
+
+            auto & item = items[slot];
+            if (tNow_s - item.lastForceUpdate_s > 60) {
+                item.needUpdate = true;
+                item.needRequest = true;
+
+                item.lastForceUpdate_s = tNow_s;
             }
         }
+    }
 
-        for (auto id : toRefresh) {
-            if (items[id].needRequest == false) continue;
+    const Item * State::findItem(ItemId id) const {
+        const uint32_t slot = index.find(id);
+        return slot == ItemIndex::kNone ? nullptr : &items[slot];
+    }
 
-            requestJSONForURI(getItemURI(id));
-            items[id].needRequest = false;
-            updated = true;
+    Item & State::getItem(ItemId id) {
+        uint32_t slot = index.find(id);
+        if (slot == ItemIndex::kNone) {
+            slot = items.size();
+            items.emplace_back();
+            items.back().id = id;
+            index.insert(id, slot);
         }
 
-        for (auto id : toRefresh) {
-            if (items[id].needUpdate == false) continue;
+        return items[slot];
+    }
+
+    StoryView State::getStory(const Item & item) const {
+        return { strings.get(item.by), item.descendants, item.id, getKids(item.kids), item.score, item.time,
+                 getText(item.text), getText(item.title), getText(item.url), strings.get(item.domain) };
+    }
+
+    CommentView State::getComment(const Item & item) const {
+        return { strings.get(item.by), item.id, getKids(item.kids), item.parent, getText(item.text), item.time };
+    }
+
+    JobView State::getJob(const Item & item) const {
+        return { strings.get(item.by), item.id, item.score, item.time, getText(item.title), getText(item.url), strings.get(item.domain) };
+    }
+
+    size_t State::memoryUsage() const {
+        return items.capacity()*sizeof(Item) + index.memoryUsage() + strings.memoryUsage() + texts.memoryUsage() + kids.memoryUsage();
+    }
+
+    void State::setData(Item & item, Response & res) {
+        releaseData(item);
+
+        auto addText = [this](const std::string & s) { return texts.add(s.data(), s.size(), true); };
+        auto addKids = [this](const ItemIds & ids) { return kids.add(ids.data(), ids.size(), false); };
+
+        item.type = res.type;
+        switch (res.type) {
+            case ItemType::Story:
+                {
+                    const auto & story = std::get<Story>(res.data);
+                    item.by          = strings.intern(story.by);
+                    item.descendants = story.descendants;
+                    item.kids        = addKids(story.kids);
+                    item.score       = story.score;
+                    item.time        = story.time;
+                    item.text        = addText(story.text);
+                    item.title       = addText(story.title);
+                    item.url         = addText(story.url);
+                    item.domain      = strings.intern(story.domain);
+                }
+                break;
+            case ItemType::Comment:
+                {
+                    const auto & comment = std::get<Comment>(res.data);
+                    item.by     = strings.intern(comment.by);
+                    item.kids   = addKids(comment.kids);
+                    item.parent = comment.parent;
+                    item.text   = addText(comment.text);
+                    item.time   = comment.time;
+                }
+                break;
+            case ItemType::Job:
+                {
+                    const auto & job = std::get<Job>(res.data);
+                    item.by     = strings.intern(job.by);
+                    item.score  = job.score;
+                    item.time   = job.time;
+                    item.title  = addText(job.title);
+                    item.url    = addText(job.url);
+                    item.domain = strings.intern(job.domain);
+                }
+                break;
+            case ItemType::Unknown:
+            case ItemType::Poll:
+            case ItemType::PollOpt:
+                break;
+        };
+    }
+
+    // the texts and the kids of the item are not used anymore
+    void State::releaseData(Item & item) {
+        if (item.type != ItemType::Story && item.type != ItemType::Comment && item.type != ItemType::Job) {
+            return;
+        }
 
-            const auto json = getJSONForURI(getItemURI(id));
-            if (json == "") continue;
+        // every item with data has all three texts, unused ones are empty
+        texts.release(item.title, true);
+        texts.release(item.text, true);
+        texts.release(item.url, true);
+        kids.release(item.kids, false);
 
-            const auto data = JSON::parseJSONMap(json);
-            const auto type = getItemType(data);
-            auto & item = items[id];
-            switch (type) {
+        item.title = item.text = item.url = item.kids = {};
+    }
+
+    // copy the texts and the kids that are still used into new arenas
+    void State::compact() {
+        Arena<char> newTexts;
+        Arena<ItemId> newKids;
+
+        for (auto & item : items) {
+            if (item.type != ItemType::Story && item.type != ItemType::Comment && item.type != ItemType::Job) {
+                continue;
+            }
+
+            item.title = newTexts.add(texts.get(item.title), item.title.size, true);
+            item.text  = newTexts.add(texts.get(item.text),  item.text.size,  true);
+            item.url   = newTexts.add(texts.get(item.url),   item.url.size,   true);
+            item.kids  = newKids.add(kids.get(item.kids), item.kids.size, false);
+        }
+
+        texts.swap(newTexts);
+        kids.swap(newKids);
+    }
+
+    void State::apply(Response & res) {
+        if (res.id != 0) {
+            pending.erase(res.id);
+
+            const uint32_t slot = index.find(res.id);
+            if (slot == ItemIndex::kNone) return;
+
+            auto & item = items[slot];
+            if (res.isNotModified) {
+                item.needUpdate = item.type == ItemType::Unknown;
+                return;
+            }
+
+            switch (res.type) {
                 case ItemType::Unknown:
-                    {
-                    }
                     break;
                 case ItemType::Story:
-                    {
-                        if (std::holds_alternative<Story>(item.data) == false) {
-                            item.data = Story();
-                        }
-
-                        Story & story = std::get<Story>(item.data);
-                        if (item.needUpdate) {
-                            parseStory(data, story);
-                            item.needUpdate = false;
-                            updated = true;
-                        }
-                    }
-                    break;
                 case ItemType::Comment:
-                    {
-                        if (std::holds_alternative<Comment>(item.data) == false) {
-                            item.data = Comment();
-                        }
-
-                        Comment & story = std::get<Comment>(item.data);
-                        if (item.needUpdate) {
-                            parseComment(data, story);
-                            item.needUpdate = false;
-                            updated = true;
-                        }
-                    }
-                    break;
                 case ItemType::Job:
                     {
-                        if (std::holds_alternative<Job>(item.data) == false) {
-                            item.data = Job();
-                        }
-
-                        Job & job = std::get<Job>(item.data);
-                        if (item.needUpdate) {
-                            parseJob(data, job);
-                            item.needUpdate = false;
-                            updated = true;
-                        }
-                    }
-                    break;
-                case ItemType::Poll:
-                    {
-                        // temp
+                        setData(item, res);
                         item.needUpdate = false;
+
+                        received.push_back(item.id);
+                        ++nReceived;
                     }
                     break;
+                case ItemType::Poll:
                 case ItemType::PollOpt:
                     {
                         // temp
@@ -380,27 +500,32 @@ namespace HN {
                     break;
             };
 
-            break;
+            return;
         }
 
-        nFetches = getNFetches();
-        totalBytesDownloaded = getTotalBytesDownloaded();
-
-        updateRequests_impl();
-
-        return updated;
-    }
+        if (res.uri == kAPIUpdates) {
+            for (auto id : res.ids) {
+                const uint32_t slot = index.find(id);
+                if (slot == ItemIndex::kNone) continue;
+                items[slot].needUpdate = true;
+                items[slot].needRequest = true;
+            }
 
-    void State::forceUpdate(const ItemIds & toUpdate) {
-        auto tNow_s = t_s();
-        for (auto id : toUpdate) {
-            if (items.find(id) == items.end()) continue;
-            if (tNow_s - items[id].lastForceUpdate_s > 60) {
-                items[id].needUpdate = true;
-                items[id].needRequest = true;
+            return;
+        }
 
-                items[id].lastForceUpdate_s = tNow_s;
-            }
+        if (res.ids.empty()) return;
+
+        if (res.uri == kAPITopStories) {
+            idsTop = std::move(res.ids);
+        //} else if (res.uri == kAPIBestStories) {
+        //    idsBest = std::move(res.ids);
+        } else if (res.uri == kAPIShowStories) {
+            idsShow = std::move(res.ids);
+        } else if (res.uri == kAPIAskStories) {
+            idsAsk = std::move(res.ids);
+        } else if (res.uri == kAPINewStories) {
+            idsNew = std::move(res.ids);
         }
     }
 
@@ -408,18 +533,14 @@ namespace HN {
         return now - last > 30;
     }
 
-    std::string State::timeSince(uint64_t t) const {
-        auto delta = t_s() - t;
-        if (delta < 60) return std::to_string(delta) + " seconds";
-        if (delta < 3600) return std::to_string(delta/60) + " minutes";
-        if (delta < 24*3600) return std::to_string(delta/3600) + " hours";
-        return std::to_string(delta/24/3600) + " days";
+    const char * State::timeSince(uint64_t t) const {
+        return timeFormat.since((int64_t) t_s() - (int64_t) t);
     }
 
-    void State::requestJSONForURI(std::string uri) {
+    void State::requestJSONForURI(std::string uri, Priority priority) {
         snprintf(curURI, 512, "%s", uri.c_str());
 
-        requestJSONForURI_impl(std::move(uri));
+        requestJSONForURI_impl(std::move(uri), priority);
     }
 
 }
@@ -4,8 +4,14 @@
 
 #pragma once
 
-#include <map>
+#include "item-store.h"
+#include "json.h"
+#include "time-format.h"
+
+#include <array>
+#include <unordered_map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <variant>
 #include <cstdint>
@@ -15,18 +21,23 @@ namespace HN {
 using URI = std::string;
 using ItemId = int;
 using ItemIds = std::vector<ItemId>;
-using ItemData = std::map<std::string, std::string>;
 
 static const std::string kCmdPrefix = "curl -s -k ";
 
-static const URI kAPIItem = "https://hacker-news.firebaseio.com/v0/item/";
-static const URI kAPITopStories = "https://hacker-news.firebaseio.com/v0/topstories.json";
-static const URI kAPINewStories = "https://hacker-news.firebaseio.com/v0/newstories.json";
-//static const URI kAPIBestStories = "https://hacker-news.firebaseio.com/v0/beststories.json";
-static const URI kAPIAskStories = "https://hacker-news.firebaseio.com/v0/askstories.json";
-static const URI kAPIShowStories = "https://hacker-news.firebaseio.com/v0/showstories.json";
-static const URI kAPIJobStories = "https://hacker-news.firebaseio.com/v0/jobstories.json";
-static const URI kAPIUpdates = "https://hacker-news.firebaseio.com/v0/updates.json";
+static const URI kAPIBaseDefault = "https://hacker-news.firebaseio.com";
+
+// The API endpoints, under the base URI that was passed to setAPIBase() - e.g. a local mock server.
+// Set once on startup, before any requests are made.
+extern URI kAPIItem;
+extern URI kAPITopStories;
+extern URI kAPINewStories;
+//extern URI kAPIBestStories;
+extern URI kAPIAskStories;
+extern URI kAPIShowStories;
+extern URI kAPIJobStories;
+extern URI kAPIUpdates;
+
+void setAPIBase(const URI & base);
 
 struct Story {
     std::string by = "";
@@ -72,23 +83,147 @@ enum class ItemType : int {
     PollOpt,
 };
 
+// order in which the requests are served
+enum class Priority : int {
+    Visible,    // on screen
+    Prefetch,   // likely to be needed next - e.g. the rest of the open thread, the comments of the hovered story
+    Background, // story lists and updates
+    Count,
+};
+
+// An item, as it is kept in State. The strings and the kids are stored separately - see State::getStory() and co.
 struct Item {
     ItemType type = ItemType::Unknown;
 
     bool needUpdate = true;
     bool needRequest = true;
 
-    uint64_t lastForceUpdate_s = 0;
+    uint32_t lastForceUpdate_s = 0;
+
+    ItemId id = 0;
+    ItemId parent = 0;    // comments
+    int score = 0;        // stories and jobs
+    int descendants = 0;  // stories
+    uint32_t time = 0;
+
+    StrId by = 0;
+    StrId domain = 0;
+
+    Span title;
+    Span text;
+    Span url;
+    Span kids;
+};
+
+// the kids of a story or a comment - valid until the next State::update()
+struct Kids {
+    const ItemId * first = nullptr;
+    size_t n = 0;
+
+    const ItemId * begin() const { return first; }
+    const ItemId * end() const { return first + n; }
 
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+
+    ItemId operator[](size_t i) const { return first[i]; }
+};
+
+// the fields of the stored items, like Story, Comment and Job - valid until the next State::update()
+struct StoryView {
+    const char * by;
+    int descendants;
+    ItemId id;
+    Kids kids;
+    int score;
+    uint64_t time;
+    const char * text;
+    const char * title;
+    const char * url;
+    const char * domain;
+};
+
+struct CommentView {
+    const char * by;
+    ItemId id;
+    Kids kids;
+    ItemId parent;
+    const char * text;
+    uint64_t time;
+};
+
+struct JobView {
+    const char * by;
+    ItemId id;
+    int score;
+    uint64_t time;
+    const char * title;
+    const char * url;
+    const char * domain;
+};
+
+// API response, parsed and decoded by the fetch implementation - on its worker thread, when there is one
+struct Response {
+    URI uri = "";
+
+    ItemId id = 0; // non-zero for items
+    ItemType type = ItemType::Unknown;
     std::variant<Story, Comment, Job, Poll, PollOpt> data;
+
+    ItemIds ids;   // story lists and the changed items of kAPIUpdates
+
+    bool isNotModified = false; // "304 Not Modified" - the data that was received before is still current
+};
+
+URI getItemURI(ItemId id);
+Response parseResponse(URI uri, std::string_view json);
+
+enum class Endpoint : int {
+    TopStories,
+    NewStories,
+    AskStories,
+    ShowStories,
+    Updates,
+    Items,
+    Other,
+    Count,
+};
+
+static const char * const kEndpointNames[] = { "topstories", "newstories", "askstories", "showstories", "updates", "item", "other" };
+
+Endpoint getEndpoint(const URI & uri);
+
+// transfer statistics of an API endpoint
+struct EndpointStats {
+    int nRequests = 0;
+    int nNotModified = 0;        // conditional requests answered with "304 Not Modified"
+
+    uint64_t nBytesReceived = 0; // headers and bodies, as they came over the network - i.e. compressed
+    uint64_t nBytesDecoded = 0;  // bodies after decompression
+
+    float latencySum_ms = 0.0f;
+};
+
+using EndpointStatsArray = std::array<EndpointStats, (int) Endpoint::Count>;
+
+// Parses a response while it is being received. Only the story lists are parsed this way - for the rest, finish()
+// returns false and the whole body has to be passed to parseResponse().
+struct ResponseParser {
+    void begin(const URI & uri);
+    void feed(std::string_view chunk);
+    bool finish(URI uri, Response & res);
+
+    private:
+    bool isActive = false;
+    JSON::IntArrayParser ids;
 };
 
 struct State {
-    bool update(const ItemIds & toRefresh);
+    bool update(const ItemIds & toRefreshVisible, const ItemIds & toRefresh);
     void forceUpdate(const ItemIds & toUpdate);
 
     bool timeout(uint64_t now, uint64_t last) const;
-    std::string timeSince(uint64_t t) const;
+    const char * timeSince(uint64_t t) const;
 
     ItemIds idsTop;
     //ItemIds idsBest;
@@ -96,18 +231,60 @@ struct State {
     ItemIds idsAsk;
     ItemIds idsNew;
 
-    std::map<ItemId, Item> items;
+    // nullptr if the item has not been requested
+    const Item * findItem(ItemId id) const;
+
+    StoryView   getStory  (const Item & item) const;
+    CommentView getComment(const Item & item) const;
+    JobView     getJob    (const Item & item) const;
+
+    size_t nItems() const { return items.size(); }
+    size_t memoryUsage() const;
+
+    // the items received during the last update() and the number of items received so far, to find out which
+    // parts of the UI need to be laid out again
+    ItemIds received;
+    uint64_t nReceived = 0;
 
     int nFetches = 0;
+    int nMerged = 0;    // requests that were answered by a fetch that was already queued or in flight
+    int nCacheHits = 0; // requests that were answered from the on-disk cache while being fetched
     uint64_t totalBytesDownloaded = 0;
+    EndpointStatsArray endpointStats;
 
     uint64_t lastUpdatePoll_s = 0;
 
+    // max time per update() for applying the received items
+    float updateBudget_ms = 8.0f;
+
     char curURI[512];
     int nextUpdate = 0;
 
     private:
-    void requestJSONForURI(std::string uri);
+    mutable TimeFormat timeFormat;
+
+    // The items in the order they were first requested, looked up by id through the index. Authors and domains are
+    // interned, the texts and the kids are kept in arenas.
+    std::vector<Item> items;
+    ItemIndex index;
+    StringPool strings;
+    Arena<char> texts;
+    Arena<ItemId> kids;
+
+    Item & getItem(ItemId id); // adds it if needed
+    const char * getText(Span span) const { return span.size == 0 ? "" : texts.get(span); }
+    Kids getKids(Span span) const { return { kids.get(span), span.size }; }
+
+    void setData(Item & item, Response & res);
+    void releaseData(Item & item);
+    void compact();
+
+    // requested items that have not been received yet
+    std::unordered_map<ItemId, Priority> pending;
+    std::unordered_map<ItemId, Priority> wanted;
+
+    void apply(Response & res);
+    void requestJSONForURI(std::string uri, Priority priority);
 };
 
 }
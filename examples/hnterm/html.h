@@ -0,0 +1,193 @@
+/*! \file html.h
+ *  \brief Decoding of the HTML in the item texts
+ */
+
+#pragma once
+
+#include "json.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace HTML {
+
+// the typographic punctuation is shown as plain ASCII - not all terminals render it
+inline const char * asciiPunctuation(uint32_t cp) {
+    switch (cp) {
+        case 0x2013:
+        case 0x2014:
+            return "-";
+        case 0x2018:
+        case 0x2019:
+        case 0x201E:
+            return "'";
+        case 0x201C:
+        case 0x201D:
+            return "\"";
+    }
+
+    return nullptr;
+}
+
+inline void appendCodepoint(std::string & dst, uint32_t cp) {
+    if (const char * s = asciiPunctuation(cp)) {
+        dst += s;
+    } else if (cp == 0xA0) {
+        dst += ' ';
+    } else if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp < 0xE000)) {
+        JSON::appendUTF8(dst, 0xFFFD);
+    } else {
+        JSON::appendUTF8(dst, cp);
+    }
+}
+
+struct NamedEntity {
+    std::string_view name;
+    uint32_t cp;
+};
+
+static const NamedEntity kNamedEntities[] = {
+    { "amp",    '&'    },
+    { "lt",     '<'    },
+    { "gt",     '>'    },
+    { "quot",   '"'    },
+    { "apos",   '\''   },
+    { "nbsp",   0xA0   },
+    { "ndash",  0x2013 },
+    { "mdash",  0x2014 },
+    { "lsquo",  0x2018 },
+    { "rsquo",  0x2019 },
+    { "ldquo",  0x201C },
+    { "rdquo",  0x201D },
+    { "hellip", 0x2026 },
+};
+
+// "pos" points after the '&' - on success it is moved after the ';'
+inline bool parseEntity(std::string_view src, size_t & pos, uint32_t & cp) {
+    constexpr size_t kMaxLength = 10;
+
+    // do not look further, so a stray '&' costs a few steps at most
+    const size_t end = src.substr(0, pos + kMaxLength + 1).find(';', pos);
+    if (end == std::string_view::npos || end == pos) return false;
+
+    const std::string_view name = src.substr(pos, end - pos);
+    if (name[0] == '#') {
+        const bool isHex = name.size() > 1 && (name[1] == 'x' || name[1] == 'X');
+        const size_t first = isHex ? 2 : 1;
+        if (first >= name.size()) return false;
+
+        cp = 0;
+        for (size_t i = first; i < name.size(); ++i) {
+            const char ch = name[i];
+            uint32_t d = 0;
+            if      (ch >= '0' && ch <= '9')          d = ch - '0';
+            else if (isHex && ch >= 'a' && ch <= 'f') d = ch - 'a' + 10;
+            else if (isHex && ch >= 'A' && ch <= 'F') d = ch - 'A' + 10;
+            else return false;
+
+            cp = std::min(cp*(isHex ? 16 : 10) + d, 0x110000u); // out of range, but no overflow
+        }
+    } else {
+        const NamedEntity * entity = nullptr;
+        for (const auto & e : kNamedEntities) {
+            if (e.name == name) {
+                entity = &e;
+                break;
+            }
+        }
+        if (entity == nullptr) return false;
+
+        cp = entity->cp;
+    }
+
+    pos = end + 1;
+
+    return true;
+}
+
+// '<', '&' and the lead byte of U+2000 - U+2FFF, which holds the typographic punctuation
+inline bool isSpecial(char ch) {
+    return ch == '<' || ch == '&' || ch == '\xE2';
+}
+
+// position of the first special character in [p, p + n), or n if there is none
+inline size_t findSpecial(const char * p, size_t n) {
+    size_t i = 0;
+
+#ifdef JSON_SSE2
+    const __m128i lt  = _mm_set1_epi8('<');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i e2  = _mm_set1_epi8('\xE2');
+
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+        const __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, e2)));
+        const int mask = _mm_movemask_epi8(m);
+        if (mask != 0) {
+            return i + JSON::ctz32(mask);
+        }
+    }
+#endif
+
+    for (; i < n; ++i) {
+        if (isSpecial(p[i])) return i;
+    }
+
+    return n;
+}
+
+// Decode the text of an item and append it to "dst", in a single pass: the tags are stripped, paragraphs become line
+// breaks, the entities are decoded. A tag that is not closed drops the rest of the text, like before.
+inline void decode(std::string_view src, std::string & dst) {
+    // the decoded text is never longer
+    dst.reserve(dst.size() + src.size());
+
+    const size_t n = src.size();
+
+    size_t i = 0;
+    while (i < n) {
+        const size_t k = findSpecial(src.data() + i, n - i);
+        dst.append(src.data() + i, k);
+        i += k;
+        if (i >= n) break;
+
+        const char ch = src[i];
+        if (ch == '<') {
+            const size_t end = src.find('>', i + 1);
+            if (end == std::string_view::npos) break;
+
+            const std::string_view tag = src.substr(i + 1, end - i - 1);
+            if (tag == "p" || tag.compare(0, 2, "p ") == 0) {
+                dst += '\n';
+            }
+
+            i = end + 1;
+        } else if (ch == '&') {
+            size_t pos = i + 1;
+            uint32_t cp = 0;
+            if (parseEntity(src, pos, cp)) {
+                appendCodepoint(dst, cp);
+                i = pos;
+            } else {
+                dst += ch;
+                ++i;
+            }
+        } else {
+            // U+2000 - U+203F
+            if (i + 2 < n && src[i + 1] == '\x80') {
+                if (const char * s = asciiPunctuation(0x2000 | (src[i + 2] & 0x3F))) {
+                    dst += s;
+                    i += 3;
+                    continue;
+                }
+            }
+
+            dst += ch;
+            ++i;
+        }
+    }
+}
+
+}
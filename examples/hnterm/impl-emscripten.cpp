@@ -5,22 +5,32 @@
 #include <emscripten.h>
 #include <emscripten/fetch.h>
 
-#include <map>
-#include <mutex>
+#include "hn-state.h"
+
+#include "imtui/imtui-impl-emscripten.h"
+
+#include <deque>
 #include <string>
+#include <unordered_map>
 
 static int g_nFetches;
+static int g_nMerged;
 static uint64_t g_totalBytesDownloaded = 0;
 
-// not sure if this mutex is needed, but just in case
-static std::mutex g_mutex;
-static std::map<std::string, std::string> g_fetchCache;
+// the fetch callbacks run on the main thread, so the responses are parsed there
+static std::deque<HN::Response> g_responses;
+
+// requests for a URI that is already being fetched are answered by the same response - holds the start time of each
+static std::unordered_map<std::string, double> g_inFlight;
+
+// the browser decompresses the bodies and revalidates them with its HTTP cache, so only the decoded size is known
+static HN::EndpointStatsArray g_endpointStats;
 
 uint64_t t_s() {
     return emscripten_date_now()*0.001f;
 }
 
-bool hnInit() {
+bool hnInit(const char * , int ) {
     return true;
 }
 
@@ -37,28 +47,38 @@ int openInBrowser(std::string uri) {
 void downloadSucceeded(emscripten_fetch_t *fetch) {
     g_totalBytesDownloaded += fetch->numBytes;
 
-    //printf("Finished downloading %llu bytes from URL %s.\n", fetch->numBytes, fetch->url);
-    {
-        std::lock_guard<std::mutex> lock(g_mutex);
-        g_fetchCache[fetch->url] = std::string(fetch->data, fetch->numBytes-1);
+    auto & stats = g_endpointStats[(int) HN::getEndpoint(fetch->url)];
+    stats.nRequests      += 1;
+    stats.nBytesReceived += fetch->numBytes;
+    stats.nBytesDecoded  += fetch->numBytes;
+    if (auto it = g_inFlight.find(fetch->url); it != g_inFlight.end()) {
+        stats.latencySum_ms += emscripten_get_now() - it->second;
+        g_inFlight.erase(it);
     }
+
+    //printf("Finished downloading %llu bytes from URL %s.\n", fetch->numBytes, fetch->url);
+    g_responses.push_back(HN::parseResponse(fetch->url, std::string_view(fetch->data, fetch->numBytes)));
     emscripten_fetch_close(fetch);
+
+    // the page might be idle - the response is applied in the next frame
+    ImTui_ImplEmscripten_RequestRedraw();
 }
 
 void downloadFailed(emscripten_fetch_t *fetch) {
     fprintf(stderr, "Downloading %s failed, HTTP failure status code: %d.\n", fetch->url, fetch->status);
+    g_inFlight.erase(fetch->url);
     emscripten_fetch_close(fetch);
 }
 
-std::string getJSONForURI_impl(const std::string & uri) {
-    if (auto it = g_fetchCache.find(uri); it != g_fetchCache.end()) {
-        auto res = std::move(g_fetchCache[uri]);
-        g_fetchCache.erase(it);
-
-        return res;
+bool pollResponse_impl(HN::Response & res) {
+    if (g_responses.empty()) {
+        return false;
     }
 
-    return "";
+    res = std::move(g_responses.front());
+    g_responses.pop_front();
+
+    return true;
 }
 
 uint64_t getTotalBytesDownloaded() {
@@ -69,7 +89,25 @@ int getNFetches() {
     return g_nFetches;
 }
 
-void requestJSONForURI_impl(std::string uri) {
+int getNMerged() {
+    return g_nMerged;
+}
+
+int getNCacheHits() {
+    return 0;
+}
+
+void getEndpointStats_impl(HN::EndpointStatsArray & res) {
+    res = g_endpointStats;
+}
+
+// the browser schedules the fetches, so the priority is not used and requests are not cancelled
+void requestJSONForURI_impl(std::string uri, HN::Priority ) {
+    if (g_inFlight.emplace(uri, emscripten_get_now()).second == false) {
+        ++g_nMerged;
+        return;
+    }
+
     ++g_nFetches;
 
     emscripten_fetch_attr_t attr;
@@ -81,5 +119,11 @@ void requestJSONForURI_impl(std::string uri) {
     emscripten_fetch(&attr, uri.c_str());
 }
 
+void prioritizeRequest_impl(std::string , HN::Priority ) {
+}
+
+void cancelRequest_impl(std::string ) {
+}
+
 void updateRequests_impl() {
 }
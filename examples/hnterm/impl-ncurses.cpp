@@ -10,41 +10,35 @@
 #include <signal.h>
 #ifndef WIN32
 #include <unistd.h>
+#include <strings.h>
 #endif
 #include <curl/curl.h>
 
-#include <map>
+#include "hn-state.h"
+#include "item-cache.h"
+#include "spsc-queue.h"
+
 #include <array>
+#include <atomic>
+#include <algorithm>
 #include <deque>
+#include <mutex>
 #include <string>
 #include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
-#define MAX_PARALLEL 5
+#define MIN_PARALLEL 2
+#define DEFAULT_MAX_PARALLEL 32
+#define MAX_RETRIES 3
 
 //#define DEBUG_SIGPIPE
 
-#if defined(DEBUG_SIGPIPE) || defined(ENABLE_API_CACHE)
+#if defined(DEBUG_SIGPIPE)
 #include <fstream>
 #endif
 
-namespace {
-#ifdef ENABLE_API_CACHE
-    inline std::string getCacheFname(const std::string & uri) {
-        std::string fname = "cache-" + uri;
-        for (auto & ch : fname) {
-            if ((ch >= 'a' && ch <= 'z') ||
-                (ch >= 'A' && ch <= 'Z') ||
-                (ch >= '0' && ch <= '9')) {
-                continue;
-            }
-            ch = '-';
-        }
-
-        return fname;
-    }
-#endif
-}
-
 void sigpipe_handler([[maybe_unused]] int signal) {
 #ifdef DEBUG_SIGPIPE
     std::ofstream fout("SIGPIPE.OCCURED");
@@ -55,18 +49,166 @@ void sigpipe_handler([[maybe_unused]] int signal) {
 
 struct Data {
     CURL *eh = NULL;
-    bool running = false;
     std::string uri = "";
-    std::string content = "";
+    std::string etag = "";
+    std::string lastModified = "";
+    std::string content = ""; // taken from g_buffers for the duration of the transfer
+
+    struct curl_slist *headers = NULL;
+
+#ifdef HNTERM_INCREMENTAL_PARSE
+    HN::ResponseParser parser;
+#endif
+};
+
+// The response bodies are assembled in buffers that are reused between transfers, so they do not have to grow again
+// for every response. Only the worker uses the pool.
+struct BufferPool {
+    static constexpr size_t kMaxCapacity = 1024*1024; // larger buffers are not kept
+
+    std::string acquire() {
+        if (buffers.empty()) {
+            return std::string();
+        }
+
+        auto res = std::move(buffers.back());
+        buffers.pop_back();
+
+        return res;
+    }
+
+    void release(std::string && buffer) {
+        if (buffer.capacity() > kMaxCapacity) {
+            return;
+        }
+
+        buffer.clear();
+        buffers.push_back(std::move(buffer));
+    }
+
+    private:
+    std::vector<std::string> buffers;
+};
+
+// The transfers and their easy handles are reused. The pool grows up to the highest number of parallel transfers
+// so far - a finished transfer goes to a free list, where the next one is taken from. Only the worker uses the pool.
+struct TransferPool {
+    Data * acquire() {
+        Data * res = NULL;
+        if (free.empty()) {
+            transfers.emplace_back();
+            res = &transfers.back();
+            res->eh = curl_easy_init();
+        } else {
+            res = free.back();
+            free.pop_back();
+        }
+
+        ++nRunning;
+
+        return res;
+    }
+
+    void release(Data * data) {
+        free.push_back(data);
+        --nRunning;
+    }
+
+    void clear() {
+        for (auto & data : transfers) {
+            curl_easy_cleanup(data.eh);
+        }
+        transfers.clear();
+        free.clear();
+        nRunning = 0;
+    }
+
+    int nRunning = 0;
+
+    private:
+    std::deque<Data> transfers; // stable addresses - the easy handles point to their Data
+    std::vector<Data *> free;
 };
 
+// The transfers run on a worker thread that owns the curl multi handle. The finished responses are parsed there
+// as well and passed to the UI thread through a lock-free queue, so the UI thread only has to apply them.
+
 static CURLM *g_cm;
 
-static int g_nFetches = 0;
-static uint64_t g_totalBytesDownloaded = 0;
-static std::deque<std::string> g_fetchQueue;
-static std::map<std::string, std::string> g_fetchCache;
-static std::array<Data, MAX_PARALLEL> g_fetchData;
+static std::atomic<int> g_nFetches = 0;
+static std::atomic<uint64_t> g_totalBytesDownloaded = 0;
+
+static std::atomic<bool> g_isRunning = false;
+static std::thread g_worker;
+
+struct Command {
+    enum Op {
+        Request,
+        Prioritize,
+        Cancel,
+    };
+
+    Op op;
+    std::string uri;
+    int priority; // HN::Priority
+};
+
+// UI thread -> worker
+static SpscQueue<Command> g_commands(12);
+static std::deque<Command> g_commandsPending; // did not fit in g_commands yet, UI thread only
+
+// worker -> UI thread
+static SpscQueue<HN::Response> g_responses(12);
+static std::deque<HN::Response> g_responsesPending; // did not fit in g_responses yet, worker only
+
+// Every URI that is queued or being fetched has one entry in the request table. New requests for it are merged into
+// that entry and are all answered by the same response.
+struct Request {
+    int priority = 0;
+    uint64_t seq = 0;        // of its latest entry in g_fetchQueue
+    Data * transfer = NULL;  // NULL while queued
+    int nRetries = 0;
+};
+
+// worker only
+static uint64_t g_seq = 0;
+static std::unordered_map<std::string, Request> g_requestTable;
+static TransferPool g_transfers;
+static BufferPool g_buffers;
+
+// Requests waiting for a free transfer, one FIFO per priority. Changing the priority of a request queues it again
+// with a new sequence number - the entries that do not match the request table anymore are skipped.
+static std::array<std::deque<std::pair<uint64_t, std::string>>, (int) HN::Priority::Count> g_fetchQueue;
+
+static std::atomic<int> g_nMerged = 0;
+
+// The first request for a URI in this session is answered from the cache right away, if possible - e.g. the front
+// page of the last session is shown on startup. The request is still fetched, to get the current content.
+static ItemCache g_cache;
+static ItemCache::Entry g_cacheEntry;
+static std::unordered_set<std::string> g_seen; // worker only
+
+static std::atomic<int> g_nCacheHits = 0;
+
+// Validators of the last response of each URI that the UI thread has received. The next request for the URI is made
+// conditional, so an unchanged response is answered with "304 Not Modified" and no body.
+struct Validators {
+    std::string etag;
+    std::string lastModified;
+};
+
+static std::unordered_map<std::string, Validators> g_validators; // worker only
+
+static std::mutex g_statsMutex;
+static HN::EndpointStatsArray g_endpointStats;
+
+// Number of parallel transfers - grows while the latency stays close to the best one seen recently and backs off
+// when it degrades. Over HTTP/2 all of them are multiplexed over a single connection, so a large thread can be
+// requested a whole level of comments at a time. Over HTTP/1.1 each one gets its own connection, up to g_maxParallel.
+static int g_maxParallel = DEFAULT_MAX_PARALLEL;
+static float g_nParallel = 5.0f;
+static bool g_isSlowStart = true;
+static float g_minLatency_ms = 1e9f;
 
 uint64_t t_s() {
     return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count(); // duh ..
@@ -74,38 +216,335 @@ uint64_t t_s() {
 
 static size_t writeFunction(void *ptr, size_t size, size_t nmemb, Data* data) {
     size_t bytesDownloaded = size*nmemb;
-    g_totalBytesDownloaded += bytesDownloaded;
 
-    data->content.append((char*) ptr, bytesDownloaded);
+    // the chunks of a response are collected until the transfer is done
+    if (data->content.empty()) {
+        curl_off_t contentLength = -1;
+        curl_easy_getinfo(data->eh, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+        if (contentLength > 0) {
+            data->content.reserve(contentLength);
+        }
+    }
 
-#ifdef ENABLE_API_CACHE
-    auto fname = ::getCacheFname(data->uri);
+    data->content.append((char*) ptr, bytesDownloaded);
 
-    std::ofstream fout(fname);
-    fout.write(data->content.c_str(), data->content.size());
-    fout.close();
+#ifdef HNTERM_INCREMENTAL_PARSE
+    data->parser.feed(std::string_view((char*) ptr, bytesDownloaded));
 #endif
 
-    g_fetchCache[data->uri] = std::move(data->content);
-    data->content.clear();
-
     return bytesDownloaded;
 }
 
-static void addTransfer(CURLM *cm, int idx, std::string && uri) {
-    if (g_fetchData[idx].eh == NULL) {
-        g_fetchData[idx].eh = curl_easy_init();
+// if "header" is "name: value", return the value
+static bool getHeaderValue(std::string_view header, std::string_view name, std::string & res) {
+    if (header.size() <= name.size() || header[name.size()] != ':' || strncasecmp(header.data(), name.data(), name.size()) != 0) {
+        return false;
     }
 
-    CURL *eh = g_fetchData[idx].eh;
-    curl_easy_setopt(eh, CURLOPT_URL, uri.c_str());
-    curl_easy_setopt(eh, CURLOPT_PRIVATE, &g_fetchData[idx]);
+    header.remove_prefix(name.size() + 1);
+    while (header.empty() == false && (header.front() == ' ' || header.front() == '\t')) header.remove_prefix(1);
+    while (header.empty() == false && (header.back() == '\r' || header.back() == '\n' || header.back() == ' ')) header.remove_suffix(1);
+    res = header;
+
+    return true;
+}
+
+static size_t headerFunction(char *buffer, size_t size, size_t nitems, Data* data) {
+    const size_t n = size*nitems;
+    const std::string_view header(buffer, n);
+
+    getHeaderValue(header, "etag", data->etag) || getHeaderValue(header, "last-modified", data->lastModified);
+
+    return n;
+}
+
+static void addTransfer(CURLM *cm, Data * data) {
+    data->content = g_buffers.acquire();
+#ifdef HNTERM_INCREMENTAL_PARSE
+    data->parser.begin(data->uri);
+#endif
+
+    CURL *eh = data->eh;
+    curl_easy_setopt(eh, CURLOPT_URL, data->uri.c_str());
+    curl_easy_setopt(eh, CURLOPT_PRIVATE, data);
     curl_easy_setopt(eh, CURLOPT_WRITEFUNCTION, writeFunction);
-    curl_easy_setopt(eh, CURLOPT_WRITEDATA, &g_fetchData[idx]);
+    curl_easy_setopt(eh, CURLOPT_WRITEDATA, data);
+    curl_easy_setopt(eh, CURLOPT_HEADERFUNCTION, headerFunction);
+    curl_easy_setopt(eh, CURLOPT_HEADERDATA, data);
+
+    // prefer waiting for an HTTP/2 connection that is being set up over opening a new one
+    curl_easy_setopt(eh, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+    curl_easy_setopt(eh, CURLOPT_PIPEWAIT, 1L);
+
+    // any compression that curl was built with
+    curl_easy_setopt(eh, CURLOPT_ACCEPT_ENCODING, "");
+
+    struct curl_slist *headers = NULL;
+    if (auto it = g_validators.find(data->uri); it != g_validators.end()) {
+        if (it->second.etag.empty() == false) {
+            headers = curl_slist_append(headers, ("If-None-Match: " + it->second.etag).c_str());
+        }
+        if (it->second.lastModified.empty() == false) {
+            headers = curl_slist_append(headers, ("If-Modified-Since: " + it->second.lastModified).c_str());
+        }
+    }
+    data->headers = headers;
+    curl_easy_setopt(eh, CURLOPT_HTTPHEADER, headers);
+
     curl_multi_add_handle(cm, eh);
 }
 
-bool hnInit() {
+static void publishResponses() {
+    while (g_responsesPending.empty() == false && g_responses.push(std::move(g_responsesPending.front()))) {
+        g_responsesPending.pop_front();
+    }
+}
+
+static void publishResponse(std::string uri, std::string_view json) {
+    g_responsesPending.push_back(HN::parseResponse(std::move(uri), json));
+    publishResponses();
+}
+
+// the transfer is done or aborted - give it and its buffer back to the pools
+static void releaseTransfer(Data & data) {
+    data.etag.clear();
+    data.lastModified.clear();
+
+    curl_slist_free_all(data.headers);
+    data.headers = NULL;
+
+    g_buffers.release(std::move(data.content));
+    data.content = std::string();
+
+    g_transfers.release(&data);
+}
+
+static void enqueue(const std::string & uri, Request & req, int priority) {
+    req.priority = priority;
+    req.seq = ++g_seq;
+    g_fetchQueue[priority].emplace_back(req.seq, uri);
+}
+
+static void applyCommand(Command && cmd) {
+    auto it = g_requestTable.find(cmd.uri);
+
+    switch (cmd.op) {
+        case Command::Request:
+            {
+                if (it == g_requestTable.end()) {
+                    if (g_seen.insert(cmd.uri).second && g_cache.get(cmd.uri, g_cacheEntry, t_s())) {
+                        ++g_nCacheHits;
+                        publishResponse(cmd.uri, g_cacheEntry.body);
+
+                        if (g_cacheEntry.etag.empty() == false) {
+                            g_validators[cmd.uri].etag = g_cacheEntry.etag;
+                        }
+                    }
+
+                    enqueue(cmd.uri, g_requestTable[cmd.uri], cmd.priority);
+                    break;
+                }
+
+                ++g_nMerged;
+
+                // the merged request keeps the higher of the two priorities
+                auto & req = it->second;
+                if (req.transfer == NULL && cmd.priority < req.priority) {
+                    enqueue(it->first, req, cmd.priority);
+                }
+            }
+            break;
+        case Command::Prioritize:
+            {
+                if (it == g_requestTable.end()) break;
+
+                auto & req = it->second;
+                if (req.transfer == NULL && cmd.priority != req.priority) {
+                    enqueue(it->first, req, cmd.priority);
+                }
+            }
+            break;
+        case Command::Cancel:
+            {
+                if (it == g_requestTable.end()) break;
+
+                // abort the transfer if it has already started
+                if (auto data = it->second.transfer) {
+                    curl_multi_remove_handle(g_cm, data->eh);
+                    releaseTransfer(*data);
+                }
+
+                g_requestTable.erase(it);
+            }
+            break;
+    };
+}
+
+// next request to start, highest priority first
+static Request * popRequest(std::string & uri) {
+    for (auto & queue : g_fetchQueue) {
+        while (queue.empty() == false) {
+            auto entry = std::move(queue.front());
+            queue.pop_front();
+
+            auto it = g_requestTable.find(entry.second);
+            if (it == g_requestTable.end() || it->second.transfer != NULL || it->second.seq != entry.first) continue;
+
+            uri = std::move(entry.second);
+
+            return &it->second;
+        }
+    }
+
+    return NULL;
+}
+
+static void updateConcurrency(float latency_ms) {
+    // slowly forget the best latency, so a change of network conditions is picked up
+    g_minLatency_ms = std::min(1.01f*g_minLatency_ms, latency_ms);
+
+    if (latency_ms < 2.0f*g_minLatency_ms) {
+        // until the first back off, double the number of transfers every round trip
+        g_nParallel = std::min(g_nParallel + (g_isSlowStart ? 1.0f : 1.0f/g_nParallel), (float) g_maxParallel);
+    } else {
+        g_isSlowStart = false;
+        g_nParallel = std::max(0.9f*g_nParallel, (float) MIN_PARALLEL);
+    }
+}
+
+static void updateTransfers() {
+    {
+        Command cmd;
+        while (g_commands.pop(cmd)) {
+            applyCommand(std::move(cmd));
+        }
+    }
+
+    // the finished transfers are collected right after they are driven, so the free slots are refilled before the
+    // worker goes to sleep
+    int still_alive = 1;
+
+    curl_multi_perform(g_cm, &still_alive);
+
+    CURLMsg *msg;
+    int msgs_left = -1;
+
+    while ((msg = curl_multi_info_read(g_cm, &msgs_left))) {
+        if (msg->msg == CURLMSG_DONE) {
+            Data* data;
+            CURL *e = msg->easy_handle;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &data);
+            curl_multi_remove_handle(g_cm, e);
+            //curl_easy_cleanup(e);
+            //data->eh = NULL;
+
+            long code = 0;
+            curl_easy_getinfo(e, CURLINFO_RESPONSE_CODE, &code);
+
+            // network and server errors are retried a few times, before the request is given up
+            if (msg->data.result != CURLE_OK || code >= 500) {
+                auto it = g_requestTable.find(data->uri);
+                if (it != g_requestTable.end() && ++it->second.nRetries <= MAX_RETRIES) {
+                    it->second.transfer = NULL;
+                    enqueue(it->first, it->second, it->second.priority);
+                    releaseTransfer(*data);
+                    continue;
+                }
+            }
+
+            g_requestTable.erase(data->uri);
+
+            if (msg->data.result == CURLE_OK) {
+                curl_off_t total_us = 0;
+                curl_easy_getinfo(e, CURLINFO_TOTAL_TIME_T, &total_us);
+
+                // The time from sending the request to the first byte of the response. The total time also counts
+                // the wait for a connection, which would make the controller back off from its own queueing.
+                curl_off_t pretransfer_us = 0;
+                curl_off_t starttransfer_us = 0;
+                curl_easy_getinfo(e, CURLINFO_PRETRANSFER_TIME_T, &pretransfer_us);
+                curl_easy_getinfo(e, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer_us);
+                updateConcurrency(1e-3f*(starttransfer_us - pretransfer_us));
+
+                // as received - before decompression
+                curl_off_t nBodyBytes = 0;
+                curl_easy_getinfo(e, CURLINFO_SIZE_DOWNLOAD_T, &nBodyBytes);
+                long nHeaderBytes = 0;
+                curl_easy_getinfo(e, CURLINFO_HEADER_SIZE, &nHeaderBytes);
+
+                g_totalBytesDownloaded += nBodyBytes + nHeaderBytes;
+
+                {
+                    std::lock_guard<std::mutex> lock(g_statsMutex);
+                    auto & stats = g_endpointStats[(int) HN::getEndpoint(data->uri)];
+                    stats.nRequests      += 1;
+                    stats.nNotModified   += code == 304 ? 1 : 0;
+                    stats.nBytesReceived += nBodyBytes + nHeaderBytes;
+                    stats.nBytesDecoded  += data->content.size();
+                    stats.latencySum_ms  += 1e-3f*total_us;
+                }
+
+                if (code == 304) {
+                    HN::Response res = HN::parseResponse(data->uri, "");
+                    res.isNotModified = true;
+                    g_responsesPending.push_back(std::move(res));
+                    publishResponses();
+                } else {
+                    if (code == 200) {
+                        if (data->etag.empty() == false || data->lastModified.empty() == false) {
+                            g_validators[data->uri] = { data->etag, data->lastModified };
+                        }
+                        g_cache.put(data->uri, data->etag, data->content, t_s());
+                    }
+
+#ifdef HNTERM_INCREMENTAL_PARSE
+                    HN::Response res;
+                    if (data->parser.finish(data->uri, res)) {
+                        g_responsesPending.push_back(std::move(res));
+                        publishResponses();
+                    } else {
+                        publishResponse(data->uri, data->content);
+                    }
+#else
+                    publishResponse(data->uri, data->content);
+#endif
+                }
+            } else {
+                // an empty response - the UI thread stops waiting for it
+                publishResponse(data->uri, "");
+            }
+
+            releaseTransfer(*data);
+        } else {
+            fprintf(stderr, "E: CURLMsg (%d)\n", msg->msg);
+        }
+    }
+
+    std::string uri;
+    while (g_transfers.nRunning < (int) g_nParallel) {
+        auto req = popRequest(uri);
+        if (req == NULL) break;
+
+        ++g_nFetches;
+
+        req->transfer = g_transfers.acquire();
+        req->transfer->uri = std::move(uri);
+        addTransfer(g_cm, req->transfer);
+    }
+
+    publishResponses();
+}
+
+static void runWorker() {
+    while (g_isRunning) {
+        updateTransfers();
+
+        // sleep until there is network activity or a new request - poll more often while the UI thread is behind
+        curl_multi_poll(g_cm, NULL, 0, g_responsesPending.empty() ? 1000 : 10, NULL);
+    }
+}
+
+bool hnInit(const char * cacheFname, int maxParallel) {
 #ifndef _WIN32
     struct sigaction sh;
     struct sigaction osh;
@@ -125,12 +564,36 @@ bool hnInit() {
     curl_global_init(CURL_GLOBAL_ALL);
     g_cm = curl_multi_init();
 
-    curl_multi_setopt(g_cm, CURLMOPT_MAXCONNECTS, (long)MAX_PARALLEL);
+    if (maxParallel > 0) {
+        g_maxParallel = std::max(maxParallel, MIN_PARALLEL);
+        g_nParallel = std::min(g_nParallel, (float) g_maxParallel);
+    }
+
+    curl_multi_setopt(g_cm, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(g_cm, CURLMOPT_MAX_HOST_CONNECTIONS, (long)g_maxParallel);
+    curl_multi_setopt(g_cm, CURLMOPT_MAXCONNECTS, (long)g_maxParallel);
+
+    // the app works without the cache, just slower to start
+    if (cacheFname && g_cache.open(cacheFname) == false) {
+        fprintf(stderr, "Warning: failed to open the item cache '%s' - %s\n", cacheFname, strerror(errno));
+    }
+
+    g_isRunning = true;
+    g_worker = std::thread(runWorker);
 
     return true;
 }
 
 void hnFree() {
+    g_isRunning = false;
+    curl_multi_wakeup(g_cm);
+    if (g_worker.joinable()) {
+        g_worker.join();
+    }
+
+    g_cache.close();
+
+    g_transfers.clear();
     curl_multi_cleanup(g_cm);
     curl_global_cleanup();
 }
@@ -144,82 +607,51 @@ int openInBrowser(std::string uri) {
     return system(cmd.c_str());
 }
 
-std::string getJSONForURI_impl(const std::string & uri) {
-    if (auto it = g_fetchCache.find(uri); it != g_fetchCache.end()) {
-        auto res = std::move(g_fetchCache[uri]);
-        g_fetchCache.erase(it);
-
-        return res;
-    }
-
-    return "";
+bool pollResponse_impl(HN::Response & res) {
+    return g_responses.pop(res);
 }
 
 uint64_t getTotalBytesDownloaded() {
     return g_totalBytesDownloaded;
 }
 
-uint64_t getNFetches() {
+int getNFetches() {
     return g_nFetches;
 }
 
-void requestJSONForURI_impl(std::string uri) {
-    g_fetchQueue.push_back(std::move(uri));
+int getNMerged() {
+    return g_nMerged;
 }
 
-void updateRequests_impl() {
-    CURLMsg *msg;
-    int msgs_left = -1;
-
-    while ((msg = curl_multi_info_read(g_cm, &msgs_left))) {
-        if (msg->msg == CURLMSG_DONE) {
-            Data* data;
-            CURL *e = msg->easy_handle;
-            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &data);
-            data->running = false;
-            curl_multi_remove_handle(g_cm, e);
-            //curl_easy_cleanup(e);
-            //data->eh = NULL;
-        } else {
-            fprintf(stderr, "E: CURLMsg (%d)\n", msg->msg);
-        }
-    }
-
-    int still_alive = 1;
-
-    curl_multi_perform(g_cm, &still_alive);
-
-    while (still_alive < MAX_PARALLEL && g_fetchQueue.size() > 0) {
-        long unsigned int idx = 0;
-        while (g_fetchData[idx].running) {
-            ++idx;
-            if (idx == g_fetchData.size()) break;
-        }
-        if (idx == g_fetchData.size()) break;
-
-        auto uri = std::move(g_fetchQueue.front());
-        g_fetchQueue.pop_front();
-
-#ifdef ENABLE_API_CACHE
-        auto fname = ::getCacheFname(uri);
+int getNCacheHits() {
+    return g_nCacheHits;
+}
 
-        std::ifstream fin(fname);
-        if (fin.is_open() && fin.good()) {
-            std::string str((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
-            fin.close();
+void getEndpointStats_impl(HN::EndpointStatsArray & res) {
+    std::lock_guard<std::mutex> lock(g_statsMutex);
+    res = g_endpointStats;
+}
 
-            g_fetchCache[uri] = std::move(str);
+void requestJSONForURI_impl(std::string uri, HN::Priority priority) {
+    g_commandsPending.push_back({ Command::Request, std::move(uri), (int) priority });
+}
 
-            continue;
-        }
-#endif
+void prioritizeRequest_impl(std::string uri, HN::Priority priority) {
+    g_commandsPending.push_back({ Command::Prioritize, std::move(uri), (int) priority });
+}
 
-        ++g_nFetches;
+void cancelRequest_impl(std::string uri) {
+    g_commandsPending.push_back({ Command::Cancel, std::move(uri), 0 });
+}
 
-        g_fetchData[idx].running = true;
-        g_fetchData[idx].uri = uri;
-        addTransfer(g_cm, idx, std::move(uri));
+void updateRequests_impl() {
+    if (g_commandsPending.empty()) {
+        return;
+    }
 
-        ++still_alive;
+    while (g_commandsPending.empty() == false && g_commands.push(std::move(g_commandsPending.front()))) {
+        g_commandsPending.pop_front();
     }
+
+    curl_multi_wakeup(g_cm);
 }
@@ -0,0 +1,405 @@
+/*! \file item-cache.h
+ *  \brief Persistent cache of API responses
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#define HNTERM_ITEM_CACHE
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Append-only log of API responses, memory-mapped for reading.
+//
+// Each record holds the URI, the ETag and the body of a response together with the time it was fetched. The latest
+// record of each URI is found through an in-memory index, which is rebuilt by scanning the log on open(). A torn
+// record at the end of the log (e.g. after a crash) is cut off.
+//
+// put() only queues the record - a writer thread appends the queued records in batches and compacts the log in the
+// background when most of it is made of old versions and expired records. get() can be called from any thread.
+struct ItemCache {
+    static constexpr int64_t  kMaxAge_s      = 7*24*3600; // older records are not returned and get dropped
+    static constexpr uint64_t kFlushBytes    = 256*1024;
+    static constexpr int      kFlushPeriod_ms = 1000;
+    static constexpr uint64_t kCompactBytes  = 4*1024*1024; // do not bother compacting smaller logs
+    static constexpr int64_t  kExpiryCheckPeriod_s = 60;    // the records expire also when nothing is written
+
+    struct Entry {
+        std::string etag;
+        std::string body;
+
+        int64_t t_s = 0; // when the body was fetched
+    };
+
+    ~ItemCache() { close(); }
+
+    bool open(const std::string & fname) {
+        close();
+
+#ifdef HNTERM_ITEM_CACHE
+        this->fname = fname;
+
+        makeParentDirs(fname);
+
+        fd = ::open(fname.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close();
+            return false;
+        }
+
+        if (st.st_size < (off_t) sizeof(kFileMagic) || remap(st.st_size) == false || memcmp(data, kFileMagic, sizeof(kFileMagic)) != 0) {
+            // new or foreign file - start over
+            if (ftruncate(fd, 0) != 0 || ::pwrite(fd, kFileMagic, sizeof(kFileMagic), 0) != (ssize_t) sizeof(kFileMagic)) {
+                close();
+                return false;
+            }
+            remap(sizeof(kFileMagic));
+        }
+
+        const uint64_t end = scan();
+        if (end < size) {
+            if (ftruncate(fd, end) != 0) {
+                close();
+                return false;
+            }
+            remap(end);
+        }
+
+        isOpened = true;
+        isRunning = true;
+        writer = std::thread([this]() { run(); });
+
+        return true;
+#else
+        (void) fname;
+        return false;
+#endif
+    }
+
+    // write the queued records and unmap the log
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            isRunning = false;
+        }
+        cvPending.notify_all();
+        if (writer.joinable()) {
+            writer.join();
+        }
+
+#ifdef HNTERM_ITEM_CACHE
+        flush();
+
+        if (data) {
+            munmap((void *) data, size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+#endif
+
+        data = nullptr;
+        size = 0;
+        sizeChecked = 0;
+        index.clear();
+
+        isOpened = false;
+    }
+
+    bool isOpen() const {
+        return isOpened;
+    }
+
+    bool get(const std::string & uri, Entry & res, int64_t tNow_s) const {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto it = index.find(uri);
+        if (it == index.end() || tNow_s - it->second.t_s > kMaxAge_s) {
+            return false;
+        }
+
+        RecordHeader header;
+        memcpy(&header, data + it->second.offset, sizeof(header));
+
+        const char * payload = data + it->second.offset + sizeof(header) + header.uriSize;
+        res.etag.assign(payload, header.etagSize);
+        res.body.assign(payload + header.etagSize, header.bodySize);
+        res.t_s = header.t_s;
+
+        return true;
+    }
+
+    // queue a record for writing
+    void put(std::string_view uri, std::string_view etag, std::string_view body, int64_t t_s) {
+        if (isOpen() == false) return;
+
+        RecordHeader header = {};
+        header.magic    = kRecordMagic;
+        header.uriSize  = uri.size();
+        header.etagSize = etag.size();
+        header.bodySize = body.size();
+        header.t_s      = t_s;
+        header.checksum = checksum(uri, etag, body);
+
+        bool doFlush = false;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            pending.append((const char *) &header, sizeof(header));
+            pending.append(uri);
+            pending.append(etag);
+            pending.append(body);
+
+            doFlush = pending.size() >= kFlushBytes;
+        }
+
+        if (doFlush) {
+            cvPending.notify_one();
+        }
+    }
+
+    int nEntries() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return index.size();
+    }
+
+    uint64_t fileSize() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return size;
+    }
+
+    private:
+    static constexpr char kFileMagic[8] = { 'h', 'n', 'c', 'a', 'c', 'h', 'e', '1' };
+    static constexpr uint32_t kRecordMagic = 0x2b4e4852;
+
+#ifdef HNTERM_ITEM_CACHE
+    // mkdir -p of the directory of "fname" - e.g. ~/.cache does not exist on a fresh system
+    static void makeParentDirs(const std::string & fname) {
+        for (size_t i = fname.find('/', 1); i != std::string::npos; i = fname.find('/', i + 1)) {
+            ::mkdir(fname.substr(0, i).c_str(), 0755);
+        }
+    }
+#endif
+
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t uriSize;
+        uint32_t etagSize;
+        uint32_t bodySize;
+        int64_t  t_s;
+        uint32_t checksum; // of uri + etag + body
+        uint32_t reserved;
+    };
+
+    struct Location {
+        uint64_t offset; // of the record header
+        uint64_t nBytes; // whole record
+        int64_t  t_s;
+    };
+
+    // FNV-1a
+    static uint32_t checksum(std::string_view uri, std::string_view etag, std::string_view body) {
+        uint32_t res = 2166136261u;
+        for (auto s : { uri, etag, body }) {
+            for (auto ch : s) {
+                res = (res ^ uint8_t(ch))*16777619u;
+            }
+        }
+        return res;
+    }
+
+#ifdef HNTERM_ITEM_CACHE
+    bool remap(uint64_t newSize) {
+        if (data) {
+            munmap((void *) data, size);
+            data = nullptr;
+        }
+
+        size = newSize;
+
+        void * ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED) {
+            size = 0;
+            return false;
+        }
+        data = (const char *) ptr;
+
+        return true;
+    }
+
+    // index the valid records in [pos, size) - returns the end of the last one
+    uint64_t scan(uint64_t pos = sizeof(kFileMagic)) {
+        while (pos + sizeof(RecordHeader) <= size) {
+            RecordHeader header;
+            memcpy(&header, data + pos, sizeof(header));
+
+            const uint64_t nBytes = sizeof(header) + uint64_t(header.uriSize) + header.etagSize + header.bodySize;
+            if (header.magic != kRecordMagic || pos + nBytes > size) break;
+
+            const std::string_view uri (data + pos + sizeof(header), header.uriSize);
+            const std::string_view etag(uri.data() + uri.size(), header.etagSize);
+            const std::string_view body(etag.data() + etag.size(), header.bodySize);
+            if (checksum(uri, etag, body) != header.checksum) break;
+
+            index[std::string(uri)] = { pos, nBytes, header.t_s };
+
+            pos += nBytes;
+        }
+
+        return pos;
+    }
+
+    // append the queued records to the log
+    void flush() {
+        std::string batch;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            batch.swap(pending);
+        }
+        if (batch.empty() || fd < 0) return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const uint64_t begin = size;
+        if (::pwrite(fd, batch.data(), batch.size(), begin) != (ssize_t) batch.size()) {
+            // a partially written batch is overwritten by the next one, or cut off on the next open()
+            return;
+        }
+
+        if (remap(begin + batch.size()) == false) {
+            index.clear();
+            return;
+        }
+
+        scan(begin);
+    }
+
+    // rewrite the log with only the latest, not expired record of each URI
+    // the writer thread is the only one that modifies the log and the index, so they can be read here without locking
+    void compact(int64_t tNow_s) {
+        const std::string fnameTmp = fname + ".tmp";
+
+        const int fdTmp = ::open(fnameTmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fdTmp < 0) {
+            return;
+        }
+
+        std::vector<const Location *> live;
+        for (const auto & it : index) {
+            if (tNow_s - it.second.t_s <= kMaxAge_s) {
+                live.push_back(&it.second);
+            }
+        }
+
+        // keep the original order, so the file is read sequentially
+        std::sort(live.begin(), live.end(), [](const auto * a, const auto * b) { return a->offset < b->offset; });
+
+        std::string buf(kFileMagic, sizeof(kFileMagic));
+        uint64_t nWritten = 0;
+        bool isOk = true;
+        for (const auto * loc : live) {
+            buf.append(data + loc->offset, loc->nBytes);
+            if (buf.size() >= kFlushBytes) {
+                isOk &= ::pwrite(fdTmp, buf.data(), buf.size(), nWritten) == (ssize_t) buf.size();
+                nWritten += buf.size();
+                buf.clear();
+            }
+        }
+        isOk &= ::pwrite(fdTmp, buf.data(), buf.size(), nWritten) == (ssize_t) buf.size();
+        nWritten += buf.size();
+
+        if (isOk == false || fsync(fdTmp) != 0 || rename(fnameTmp.c_str(), fname.c_str()) != 0) {
+            ::close(fdTmp);
+            unlink(fnameTmp.c_str());
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        ::close(fd);
+        fd = fdTmp;
+
+        index.clear();
+        if (remap(nWritten)) {
+            scan();
+        }
+    }
+
+    // size of the latest, not expired record of each URI
+    uint64_t liveBytes(int64_t tNow_s) const {
+        uint64_t res = 0;
+        for (const auto & it : index) {
+            if (tNow_s - it.second.t_s <= kMaxAge_s) {
+                res += it.second.nBytes;
+            }
+        }
+        return res;
+    }
+
+    void run() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(pendingMutex);
+                cvPending.wait_for(lock, std::chrono::milliseconds(kFlushPeriod_ms), [this]() {
+                    return pending.size() >= kFlushBytes || isRunning == false;
+                });
+                if (isRunning == false) break;
+            }
+
+            flush();
+
+            const int64_t tNow_s = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            if (size > kCompactBytes && (size != sizeChecked || tNow_s - tChecked_s >= kExpiryCheckPeriod_s)) {
+                sizeChecked = size;
+                tChecked_s = tNow_s;
+
+                if (2*liveBytes(tNow_s) < size) {
+                    compact(tNow_s);
+                }
+            }
+        }
+    }
+
+    std::string fname;
+    int fd = -1;
+#endif
+
+    const char * data = nullptr;
+    uint64_t size = 0;
+
+    // the log size and the time of the last compaction check - by the writer thread
+    uint64_t sizeChecked = 0;
+    int64_t tChecked_s = 0;
+
+    mutable std::mutex mutex; // data, size and index
+    std::unordered_map<std::string, Location> index;
+
+    bool isOpened = false;
+    bool isRunning = false;
+    std::thread writer;
+
+    std::mutex pendingMutex;
+    std::condition_variable cvPending;
+    std::string pending;
+};
@@ -0,0 +1,187 @@
+/*! \file item-store.h
+ *  \brief Compact storage of the received items
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace HN {
+
+using StrId = uint32_t; // 0 - empty string
+
+// Interned strings - authors and domains repeat a lot. Never shrinks, the strings are stored once per session.
+// The strings are null-terminated and do not move.
+struct StringPool {
+    static constexpr size_t kBlockSize = 64*1024;
+
+    StringPool() {
+        intern("");
+    }
+
+    StrId intern(std::string_view s) {
+        if (auto it = index.find(s); it != index.end()) {
+            return it->second;
+        }
+
+        if (blocks.empty() || blockUsed + s.size() + 1 > blockSize) {
+            blockSize = std::max(kBlockSize, s.size() + 1);
+            blocks.emplace_back(new char[blockSize]);
+            blockUsed = 0;
+            nBytes += blockSize;
+        }
+
+        char * dst = blocks.back().get() + blockUsed;
+        memcpy(dst, s.data(), s.size());
+        dst[s.size()] = 0;
+        blockUsed += s.size() + 1;
+
+        const StrId res = strings.size();
+        strings.push_back(dst);
+        index.emplace(std::string_view(dst, s.size()), res);
+
+        return res;
+    }
+
+    const char * get(StrId id) const {
+        return strings[id];
+    }
+
+    size_t size() const {
+        return strings.size();
+    }
+
+    size_t memoryUsage() const {
+        return nBytes + strings.capacity()*sizeof(const char *) + index.size()*(sizeof(std::string_view) + sizeof(StrId) + 2*sizeof(void *));
+    }
+
+    private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockSize = 0;
+    size_t blockUsed = 0;
+    size_t nBytes = 0;
+
+    std::vector<const char *> strings;
+    std::unordered_map<std::string_view, StrId> index;
+};
+
+// [offset, offset + size) in an Arena
+struct Span {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+};
+
+// Append-only storage for the variable-size parts of the items - the texts (null-terminated) and the lists of kids.
+// Replaced parts are only counted - once they make up most of the arena, the owner copies the live parts into a new
+// one, see State::compact(). The data moves when the arena grows, so pointers into it are valid until the next
+// change.
+template <typename T>
+struct Arena {
+    Span add(const T * src, size_t n, bool isString) {
+        Span res;
+        res.offset = data.size();
+        res.size = n;
+
+        data.insert(data.end(), src, src + n);
+        if (isString) {
+            data.push_back(T());
+        }
+
+        return res;
+    }
+
+    void release(Span span, bool isString) {
+        nWasted += span.size + (isString ? 1 : 0);
+    }
+
+    const T * get(Span span) const {
+        return data.data() + span.offset;
+    }
+
+    bool needCompact() const {
+        return data.size() > 64*1024 && 2*nWasted > data.size();
+    }
+
+    size_t memoryUsage() const {
+        return data.capacity()*sizeof(T);
+    }
+
+    void swap(Arena & other) {
+        data.swap(other.data);
+        std::swap(nWasted, other.nWasted);
+    }
+
+    private:
+    std::vector<T> data;
+    size_t nWasted = 0;
+};
+
+// Maps item ids to slots in a dense array - open addressing with linear probing. The ids are never removed.
+struct ItemIndex {
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    uint32_t find(int id) const {
+        if (keys.empty()) return kNone;
+
+        for (size_t i = hash(id) & mask(); ; i = (i + 1) & mask()) {
+            if (keys[i] == id) return slots[i];
+            if (keys[i] == 0) return kNone;
+        }
+    }
+
+    // id must not be 0
+    void insert(int id, uint32_t slot) {
+        if (2*(n + 1) > keys.size()) {
+            grow();
+        }
+
+        size_t i = hash(id) & mask();
+        while (keys[i] != 0 && keys[i] != id) {
+            i = (i + 1) & mask();
+        }
+        n += keys[i] == 0 ? 1 : 0;
+        keys[i] = id;
+        slots[i] = slot;
+    }
+
+    size_t memoryUsage() const {
+        return keys.capacity()*sizeof(int) + slots.capacity()*sizeof(uint32_t);
+    }
+
+    private:
+    static size_t hash(int id) {
+        return (uint32_t(id)*2654435761u) >> 4;
+    }
+
+    size_t mask() const {
+        return keys.size() - 1;
+    }
+
+    void grow() {
+        std::vector<int> oldKeys(std::max<size_t>(1024, 2*keys.size()), 0);
+        std::vector<uint32_t> oldSlots(oldKeys.size(), kNone);
+        oldKeys.swap(keys);
+        oldSlots.swap(slots);
+
+        n = 0;
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldKeys[i] != 0) {
+                insert(oldKeys[i], oldSlots[i]);
+            }
+        }
+    }
+
+    std::vector<int> keys; // 0 - empty
+    std::vector<uint32_t> slots;
+    size_t n = 0;
+};
+
+}
@@ -4,102 +4,335 @@
 
 #pragma once
 
-#include <map>
-#include <vector>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace JSON {
 
-std::vector<int> parseIntArray(const std::string & json) {
-    std::vector<int> res;
-    if (json[0] != '[') return res;
-
-    int n = json.size();
-    int curid = 0;
-    for (int i = 1; i < n; ++i) {
-        if (json[i] == ' ') continue;
-        if (json[i] == ',') {
-            res.push_back(curid);
-            curid = 0;
-            continue;
+inline int ctz32(uint32_t x) {
+#ifdef _MSC_VER
+    unsigned long res;
+    _BitScanForward(&res, x);
+    return (int) res;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+// position of the first '"' or '\' in [p, p + n), or n if there is none
+inline size_t findQuoteOrEscape(const char * p, size_t n) {
+    size_t i = 0;
+
+#ifdef JSON_SSE2
+    const __m128i quote  = _mm_set1_epi8('"');
+    const __m128i escape = _mm_set1_epi8('\\');
+
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, escape)));
+        if (mask != 0) {
+            return i + ctz32(mask);
         }
+    }
+#endif
 
-        if (json[i] == ']') {
-            res.push_back(curid);
-            break;
+    for (; i < n; ++i) {
+        if (p[i] == '"' || p[i] == '\\') return i;
+    }
+
+    return n;
+}
+
+// position of the first '"', '[', ']', '{' or '}' in [p, p + n), or n if there is none
+inline size_t findStructural(const char * p, size_t n) {
+    size_t i = 0;
+
+#ifdef JSON_SSE2
+    // '[' and ']' differ from '{' and '}' only in bit 5
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bit5  = _mm_set1_epi8(0x20);
+    const __m128i open  = _mm_set1_epi8('{');
+    const __m128i close = _mm_set1_epi8('}');
+
+    for (; i + 16 <= n; i += 16) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+        const __m128i w = _mm_or_si128(v, bit5);
+        const __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_or_si128(_mm_cmpeq_epi8(w, open), _mm_cmpeq_epi8(w, close)));
+        const int mask = _mm_movemask_epi8(m);
+        if (mask != 0) {
+            return i + ctz32(mask);
         }
+    }
+#endif
 
-        curid = 10*curid + json[i] - 48;
+    for (; i < n; ++i) {
+        const char ch = p[i];
+        if (ch == '"' || ch == '[' || ch == ']' || ch == '{' || ch == '}') return i;
     }
 
-    return res;
+    return n;
 }
 
-std::map<std::string, std::string> parseJSONMap(const std::string & json) {
-    std::map<std::string, std::string> res;
-    if (json[0] != '{') return res;
+inline bool isSpace(char ch) {
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+}
 
-    bool hasKey = false;
-    bool inToken = false;
+// "pos" points after the opening quote - on success it is moved after the closing quote
+inline bool scanString(std::string_view json, size_t & pos, std::string_view & res) {
+    const size_t begin = pos;
+    while (pos < json.size()) {
+        pos += findQuoteOrEscape(json.data() + pos, json.size() - pos);
+        if (pos >= json.size()) break;
 
-    std::string strKey = "";
-    std::string strVal = "";
+        if (json[pos] == '\\') {
+            pos += 2;
+            continue;
+        }
 
-    int n = json.size();
-    for (int i = 1; i < n; ++i) {
-        if (!inToken) {
-            if (json[i] == ' ') continue;
-            if (json[i] == '"' && json[i-1] != '\\') {
-                inToken = true;
-                continue;
-            }
+        res = json.substr(begin, pos - begin);
+        ++pos;
+
+        return true;
+    }
+
+    return false;
+}
+
+// "pos" points at the opening bracket - on success it is moved after the matching closing bracket
+inline bool scanNested(std::string_view json, size_t & pos, std::string_view & res) {
+    const size_t begin = pos;
+
+    int depth = 0;
+    while (pos < json.size()) {
+        pos += findStructural(json.data() + pos, json.size() - pos);
+        if (pos >= json.size()) break;
+
+        const char ch = json[pos++];
+        if (ch == '"') {
+            std::string_view tmp;
+            if (scanString(json, pos, tmp) == false) return false;
+        } else if (ch == '[' || ch == '{') {
+            ++depth;
+        } else if (--depth == 0) {
+            res = json.substr(begin, pos - begin);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Tokenizes a JSON object in place and calls cb(key, value) for each of its members.
+// String values are passed without the quotes and still escaped - see unescape(). Nested arrays and objects are
+// passed whole, as they appear in the input. Returns false on malformed input. Never reads outside of "json".
+template <typename F>
+bool forEachMember(std::string_view json, F && cb) {
+    const size_t n = json.size();
+
+    size_t i = 0;
+    while (i < n && isSpace(json[i])) ++i;
+    if (i >= n || json[i] != '{') return false;
+    ++i;
+
+    while (true) {
+        while (i < n && (isSpace(json[i]) || json[i] == ',')) ++i;
+        if (i >= n) return false;
+        if (json[i] == '}') return true;
+        if (json[i] != '"') return false;
+
+        std::string_view key;
+        if (scanString(json, ++i, key) == false) return false;
+
+        while (i < n && isSpace(json[i])) ++i;
+        if (i >= n || json[i] != ':') return false;
+        ++i;
+        while (i < n && isSpace(json[i])) ++i;
+        if (i >= n) return false;
+
+        std::string_view val;
+        if (json[i] == '"') {
+            if (scanString(json, ++i, val) == false) return false;
+        } else if (json[i] == '[' || json[i] == '{') {
+            if (scanNested(json, i, val) == false) return false;
         } else {
-            if (json[i] == '"' && json[i-1] != '\\') {
-                if (hasKey == false) {
-                    hasKey = true;
-                    ++i;
-                    while (json[i] == ' ') ++i;
-                    ++i; // :
-                    while (json[i] == ' ') ++i;
-                    if (json[i] == '[') {
-                        while (json[i] != ']') {
-                            strVal += json[i++];
-                        }
-                        strVal += ']';
-                        hasKey = false;
-                        res[strKey] = strVal;
-                        strKey = "";
-                        strVal = "";
-                    } else if (json[i] != '\"') {
-                        while (json[i] != ',' && json[i] != '}') {
-                            strVal += json[i++];
+            const size_t begin = i;
+            while (i < n && json[i] != ',' && json[i] != '}' && isSpace(json[i]) == false) ++i;
+            val = json.substr(begin, i - begin);
+        }
+
+        cb(key, val);
+    }
+}
+
+// parse a decimal integer - returns "def" if "s" is not one
+template <typename T>
+T toInt(std::string_view s, T def) {
+    size_t i = 0;
+    bool neg = false;
+    if (i < s.size() && s[i] == '-') {
+        neg = true;
+        ++i;
+    }
+    if (i >= s.size()) return def;
+
+    T res = 0;
+    for (; i < s.size(); ++i) {
+        if (s[i] < '0' || s[i] > '9') return def;
+        res = 10*res + (s[i] - '0');
+    }
+
+    return neg ? -res : res;
+}
+
+// Parses a JSON array of non-negative integers that arrives in pieces. Anything other than digits, commas and the
+// closing bracket is skipped. A number that is not terminated by a comma or the closing bracket is dropped.
+struct IntArrayParser {
+    void reset() {
+        res.clear();
+        state = State::Begin;
+        cur = 0;
+        hasDigits = false;
+    }
+
+    void feed(std::string_view chunk) {
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            const char ch = chunk[i];
+            switch (state) {
+                case State::Begin:
+                    if (ch == '[') {
+                        state = State::Values;
+                    } else if (isSpace(ch) == false) {
+                        state = State::End;
+                    }
+                    break;
+                case State::Values:
+                    if (ch >= '0' && ch <= '9') {
+                        cur = 10*cur + (ch - '0');
+                        hasDigits = true;
+                    } else if (ch == ',' || ch == ']') {
+                        if (hasDigits) {
+                            res.push_back(cur);
                         }
-                        hasKey = false;
-                        res[strKey] = strVal;
-                        strKey = "";
-                        strVal = "";
-                    } else {
-                        inToken = true;
-                        continue;
+                        cur = 0;
+                        hasDigits = false;
+                        if (ch == ']') state = State::End;
                     }
-                } else {
-                    hasKey = false;
-                    res[strKey] = strVal;
-                    strKey = "";
-                    strVal = "";
-                }
-                inToken = false;
-                continue;
-            }
-            if (hasKey == false) {
-                strKey += json[i];
-            } else {
-                strVal += json[i];
+                    break;
+                case State::End:
+                    return;
             }
         }
     }
 
-    return res;
+    std::vector<int> res;
+
+    private:
+    enum class State {
+        Begin,
+        Values,
+        End,
+    };
+
+    State state = State::Begin;
+    int cur = 0;
+    bool hasDigits = false;
+};
+
+inline std::vector<int> parseIntArray(std::string_view json) {
+    IntArrayParser parser;
+    parser.feed(json);
+
+    return std::move(parser.res);
+}
+
+inline void appendUTF8(std::string & dst, uint32_t cp) {
+    if (cp < 0x80) {
+        dst += (char) cp;
+    } else if (cp < 0x800) {
+        dst += (char) (0xC0 | (cp >> 6));
+        dst += (char) (0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        dst += (char) (0xE0 | (cp >> 12));
+        dst += (char) (0x80 | ((cp >> 6) & 0x3F));
+        dst += (char) (0x80 | (cp & 0x3F));
+    } else {
+        dst += (char) (0xF0 | (cp >> 18));
+        dst += (char) (0x80 | ((cp >> 12) & 0x3F));
+        dst += (char) (0x80 | ((cp >> 6) & 0x3F));
+        dst += (char) (0x80 | (cp & 0x3F));
+    }
+}
+
+// 4 hex digits at src[pos] - returns false if they are not there
+inline bool parseHex4(std::string_view src, size_t pos, uint32_t & res) {
+    if (pos + 4 > src.size()) return false;
+
+    res = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        const char ch = src[i];
+        res <<= 4;
+        if      (ch >= '0' && ch <= '9') res |= ch - '0';
+        else if (ch >= 'a' && ch <= 'f') res |= ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'F') res |= ch - 'A' + 10;
+        else return false;
+    }
+
+    return true;
+}
+
+// decode the escape sequences of a JSON string value and append the result to "dst"
+inline void unescape(std::string_view src, std::string & dst) {
+    size_t i = 0;
+    while (i < src.size()) {
+        const size_t k = findQuoteOrEscape(src.data() + i, src.size() - i);
+        dst.append(src.data() + i, k);
+        i += k;
+        if (i >= src.size()) break;
+
+        if (src[i] != '\\' || i + 1 >= src.size()) {
+            dst += src[i++];
+            continue;
+        }
+
+        const char ch = src[i + 1];
+        i += 2;
+        switch (ch) {
+            case 'n': dst += '\n'; break;
+            case 't': dst += '\t'; break;
+            case 'r': dst += '\r'; break;
+            case 'b': dst += '\b'; break;
+            case 'f': dst += '\f'; break;
+            case 'u':
+                {
+                    uint32_t cp = 0;
+                    if (parseHex4(src, i, cp) == false) break;
+                    i += 4;
+
+                    // surrogate pair
+                    uint32_t lo = 0;
+                    if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < src.size() && src[i] == '\\' && src[i + 1] == 'u' &&
+                        parseHex4(src, i + 2, lo) && lo >= 0xDC00 && lo < 0xE000) {
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                        i += 6;
+                    }
+
+                    appendUTF8(dst, cp);
+                }
+                break;
+            default: dst += ch; break;
+        }
+    }
 }
 
 }
@@ -5,6 +5,7 @@
 #include "imtui/imtui.h"
 
 #include "hn-state.h"
+#include "thread-layout.h"
 
 #ifdef __EMSCRIPTEN__
 
@@ -32,7 +33,7 @@ bool g_updated = false;
 ImTui::TScreen * g_screen = nullptr;
 
 // platform specific functions
-extern bool hnInit();
+extern bool hnInit(const char * cacheFname, int maxParallel);
 extern void hnFree();
 extern int openInBrowser(std::string uri);
 
@@ -97,6 +98,8 @@ struct WindowData {
     int hoveredStoryId = 0;
     int hoveredCommentId = 0;
     int maxStories = 10;
+
+    HN::ThreadLayout layout;
 };
 
 struct State {
@@ -112,12 +115,14 @@ struct State {
 #endif
     bool showHelpModal = false;
     bool showStatusWindow = true;
+    bool showNetworkStats = false;
 
     int nWindows = 2;
 
     char statusWindowHeader[512];
 
     std::map<int, bool> collapsed;
+    int collapsedRevision = 0;
 
     void changeColorScheme(bool inc = true) {
         if (inc) {
@@ -175,17 +180,17 @@ struct State {
         {
             WindowContent::Top,
             false,
-            0, 0, 0, 10,
+            0, 0, 0, 10, {},
         },
         {
             WindowContent::Show,
             false,
-            0, 0, 0, 10,
+            0, 0, 0, 10, {},
         },
         {
             WindowContent::New,
             false,
-            0, 0, 0, 10,
+            0, 0, 0, 10, {},
         },
     } };
 };
@@ -203,6 +208,16 @@ extern "C" {
         bool render_frame() {
             HN::ItemIds toUpdate;
             HN::ItemIds toRefresh;
+            HN::ItemIds toRefreshVisible;
+
+            // items at the current cursor position that are on screen are refreshed first
+            auto refresh = [&](HN::ItemId id) {
+                if (ImGui::IsRectVisible(ImVec2(1, 1))) {
+                    toRefreshVisible.push_back(id);
+                } else {
+                    toRefresh.push_back(id);
+                }
+            };
 
 #ifdef __EMSCRIPTEN__
             ImTui_ImplEmscripten_NewFrame();
@@ -219,7 +234,6 @@ extern "C" {
             }
 
             for (int windowId = 0; windowId < stateUI.nWindows; ++windowId) {
-                const auto & items = stateHN.items;
                 auto & window = stateUI.windows[windowId];
 
                 {
@@ -256,19 +270,18 @@ extern "C" {
                     for (int i = 0; i < nShow; ++i) {
                         const auto & id = storyIds[i];
 
-                        toRefresh.push_back(id);
-                        if (items.find(id) == items.end() || (
-                                        std::holds_alternative<HN::Story>(items.at(id).data) == false &&
-                                        std::holds_alternative<HN::Job>(items.at(id).data) == false)) {
+                        refresh(id);
+
+                        // items that are still loading, and polls, are not shown
+                        const HN::Item * item = stateHN.findItem(id);
+                        if (item == nullptr || (item->type != HN::ItemType::Story && item->type != HN::ItemType::Job)) {
                             continue;
                         }
 
-                        const auto & item = items.at(id);
-
                         bool isHovered = false;
 
-                        if (std::holds_alternative<HN::Story>(item.data)) {
-                            const HN::Story & story = std::get<HN::Story>(item.data);
+                        if (item->type == HN::ItemType::Story) {
+                            const HN::StoryView story = stateHN.getStory(*item);
 
                             auto p0 = ImGui::GetCursorScreenPos();
 
@@ -276,7 +289,7 @@ extern "C" {
                             ImGui::PushTextWrapPos(ImGui::GetContentRegionAvailWidth());
                             ImGui::Text("%2d.", i + 1);
                             ImGui::SameLine();
-                            ImGui::Text("%s", story.title.c_str());
+                            ImGui::Text("%s", story.title);
 
                             // draw hovered story highlight
                             if (windowId == stateUI.hoveredWindowId && i == window.hoveredStoryId) {
@@ -290,7 +303,7 @@ extern "C" {
                                 if (p1.y > p0.y) {
                                     p1.x += ImGui::GetContentRegionAvailWidth() - 1;
                                 } else {
-                                    p1.x += ImGui::CalcTextSize(story.title.c_str()).x + 5;
+                                    p1.x += ImGui::CalcTextSize(story.title).x + 5;
                                 }
 
                                 // highlight rectangle
@@ -307,7 +320,7 @@ extern "C" {
                             ImGui::Text("%2d.", i + 1);
                             isHovered |= ImGui::IsItemHovered();
                             ImGui::SameLine();
-                            ImGui::Text("%s", story.title.c_str());
+                            ImGui::Text("%s", story.title);
                             isHovered |= ImGui::IsItemHovered();
 
                             ImGui::PopTextWrapPos();
@@ -317,14 +330,14 @@ extern "C" {
                                 ImGui::PopStyleColor(2);
                             }
 
-                            ImGui::TextDisabled(" (%s)", story.domain.c_str());
+                            ImGui::TextDisabled(" (%s)", story.domain);
 
                             if (stateUI.storyListMode != UI::StoryListMode::Micro) {
-                                ImGui::TextDisabled("    %d points by %s %s ago | %d comments", story.score, story.by.c_str(), stateHN.timeSince(story.time).c_str(), story.descendants);
+                                ImGui::TextDisabled("    %d points by %s %s ago | %d comments", story.score, story.by, stateHN.timeSince(story.time), story.descendants);
                                 isHovered |= ImGui::IsItemHovered();
                             }
-                        } else if (std::holds_alternative<HN::Job>(item.data)) {
-                            const HN::Job & job = std::get<HN::Job>(item.data);
+                        } else {
+                            const HN::JobView job = stateHN.getJob(*item);
 
                             if (windowId == stateUI.hoveredWindowId && i == window.hoveredStoryId) {
                                 auto col0 = ImGui::GetStyleColorVec4(ImGuiCol_Text);
@@ -335,7 +348,7 @@ extern "C" {
                                 auto p0 = ImGui::GetCursorScreenPos();
                                 p0.x += 1;
                                 auto p1 = p0;
-                                p1.x += ImGui::CalcTextSize(job.title.c_str()).x + 4;
+                                p1.x += ImGui::CalcTextSize(job.title).x + 4;
 
                                 ImGui::GetWindowDrawList()->AddRectFilled(p0, p1, ImGui::GetColorU32(col0));
 
@@ -348,7 +361,7 @@ extern "C" {
                             isHovered |= ImGui::IsItemHovered();
                             ImGui::SameLine();
                             ImGui::PushTextWrapPos(ImGui::GetContentRegionAvailWidth());
-                            ImGui::Text("%s", job.title.c_str());
+                            ImGui::Text("%s", job.title);
                             isHovered |= ImGui::IsItemHovered();
                             ImGui::PopTextWrapPos();
                             ImGui::SameLine();
@@ -357,10 +370,10 @@ extern "C" {
                                 ImGui::PopStyleColor(2);
                             }
 
-                            ImGui::TextDisabled(" (%s)", job.domain.c_str());
+                            ImGui::TextDisabled(" (%s)", job.domain);
 
                             if (stateUI.storyListMode != UI::StoryListMode::Micro) {
-                                ImGui::TextDisabled("    %d points by %s %s ago", job.score, job.by.c_str(), stateHN.timeSince(job.time).c_str());
+                                ImGui::TextDisabled("    %d points by %s %s ago", job.score, job.by, stateHN.timeSince(job.time));
                                 isHovered |= ImGui::IsItemHovered();
                             }
                         }
@@ -397,6 +410,15 @@ extern "C" {
                             toUpdate.push_back(storyIds[window.hoveredStoryId]);
                         }
 
+                        // the first level of comments of the hovered story is likely to be needed next
+                        if (window.hoveredStoryId < (int) storyIds.size()) {
+                            const HN::Item * item = stateHN.findItem(storyIds[window.hoveredStoryId]);
+                            if (item && item->type == HN::ItemType::Story) {
+                                const auto kids = stateHN.getStory(*item).kids;
+                                toRefresh.insert(toRefresh.end(), kids.begin(), kids.end());
+                            }
+                        }
+
                         if (ImGui::IsKeyPressed('k', true) ||
                             ImGui::IsKeyPressed(ImGui::GetIO().KeyMap[ImGuiKey_UpArrow], true)) {
                             window.hoveredStoryId = std::max(0, window.hoveredStoryId - 1);
@@ -421,122 +443,135 @@ extern "C" {
                         }
                     }
                 } else {
-                    if (std::holds_alternative<HN::Story>(items.at(window.selectedStoryId).data) == false) {
+                    const HN::Item * selected = stateHN.findItem(window.selectedStoryId);
+                    if (selected == nullptr || (selected->type != HN::ItemType::Story && selected->type != HN::ItemType::Unknown)) {
                         window.showComments = false;
                     } else {
-                        const auto & story = std::get<HN::Story>(items.at(window.selectedStoryId).data);
+                        const HN::StoryView story = stateHN.getStory(*selected);
 
-                        toRefresh.push_back(story.id);
+                        refresh(story.id);
 
-                        ImGui::Text("%s", story.title.c_str());
-                        ImGui::TextDisabled("%d points by %s %s ago | %d comments", story.score, story.by.c_str(), stateHN.timeSince(story.time).c_str(), story.descendants);
-                        if (story.text.empty() == false) {
+                        ImGui::Text("%s", story.title);
+                        ImGui::TextDisabled("%d points by %s %s ago | %d comments", story.score, story.by, stateHN.timeSince(story.time), story.descendants);
+                        if (story.text[0] != 0) {
                             ImGui::PushTextWrapPos(ImGui::GetContentRegionAvailWidth());
-                            ImGui::Text("%s", story.text.c_str());
+                            ImGui::Text("%s", story.text);
                             ImGui::PopTextWrapPos();
                         }
 
                         ImGui::Text("%s", "");
 
-                        int curCommentId = 0;
-                        bool forceUpdate = false;
+                        ImGui::BeginChild("##comments", ImVec2(0, 0), false, ImGuiWindowFlags_NoScrollbar);
 
-                        std::function<void(const HN::ItemIds & commentIds, int indent)> renderComments;
-                        renderComments = [&](const HN::ItemIds & commentIds, int indent) {
-                            const int nComments = commentIds.size();
-                            for (int i = 0; i < nComments; ++i) {
-                                const auto & id = commentIds[i];
+                        auto & layout = window.layout;
+                        layout.update(stateHN, story.id, (int) ImGui::GetContentRegionAvailWidth(), stateUI.collapsed, stateUI.collapsedRevision);
 
-                                if (forceUpdate) {
-                                    toUpdate.push_back(id);
-                                }
-
-                                toRefresh.push_back(commentIds[i]);
-                                if (items.find(id) == items.end() || std::holds_alternative<HN::Comment>(items.at(id).data) == false) {
-                                    continue;
-                                }
+                        const int nComments = layout.comments.size();
+                        const float lineHeight = ImGui::GetTextLineHeightWithSpacing();
+                        const bool isWindowHovered = windowId == stateUI.hoveredWindowId;
 
-                                const auto & item = items.at(id);
-                                const auto & comment = std::get<HN::Comment>(item.data);
+                        // keep the hovered comment on screen
+                        if (isWindowHovered && window.hoveredCommentId >= 0 && window.hoveredCommentId < nComments) {
+                            const int k = window.hoveredCommentId;
+                            const float y0 = layout.commentRows[k]*lineHeight;
+                            const float y1 = (k + 1 < nComments ? layout.commentRows[k + 1] - 1 : layout.rows.size() - 1)*lineHeight;
 
-                                char header[128];
-                                snprintf(header, 128, "%*s %s %s ago [%s]", indent, "", comment.by.c_str(), stateHN.timeSince(comment.time).c_str(), stateUI.collapsed[id] ? "+" : "-");
+                            if (y0 < ImGui::GetScrollY()) {
+                                ImGui::SetScrollY(y0);
+                            } else if (y1 > ImGui::GetScrollY() + ImGui::GetWindowHeight()) {
+                                ImGui::SetScrollY(y1 - ImGui::GetWindowHeight());
+                            }
+                        }
 
-                                if (windowId == stateUI.hoveredWindowId && curCommentId == window.hoveredCommentId) {
-                                    auto col0 = ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled);
-                                    auto col1 = ImGui::GetStyleColorVec4(ImGuiCol_WindowBg);
-                                    ImGui::PushStyleColor(ImGuiCol_TextDisabled, col1);
+                        // only the rows on screen are rendered
+                        int rowBegin = 0;
+                        int rowEnd = 0;
 
-                                    auto p0 = ImGui::GetCursorScreenPos();
-                                    p0.x += 1 + indent;
-                                    auto p1 = p0;
-                                    p1.x += ImGui::CalcTextSize(header).x - indent;
+                        ImGuiListClipper clipper;
+                        clipper.Begin(layout.rows.size(), lineHeight);
+                        while (clipper.Step()) {
+                            rowBegin = clipper.DisplayStart;
+                            rowEnd = clipper.DisplayEnd;
 
-                                    ImGui::GetWindowDrawList()->AddRectFilled(p0, p1, ImGui::GetColorU32(col0));
+                            for (int i = rowBegin; i < rowEnd; ++i) {
+                                const auto & row = layout.rows[i];
+                                const auto & entry = layout.comment(row.comment);
+                                const int indent = entry.depth;
+                                const bool isSelected = isWindowHovered && (int) row.comment == window.hoveredCommentId;
 
-                                    if (ImGui::GetCursorScreenPos().y < 4) {
-                                        ImGui::SetScrollHereY(0.0f);
-                                    }
+                                if (row.line == (int) entry.nLines) {
+                                    ImGui::Text("%s", "");
+                                    continue;
                                 }
 
-                                bool isHovered = false;
+                                const HN::CommentView comment = stateHN.getComment(*stateHN.findItem(entry.id));
 
-                                ImGui::TextDisabled("%s", header);
-                                isHovered |= ImGui::IsItemHovered();
+                                if (row.line < 0) {
+                                    refresh(entry.id);
 
-                                if (windowId == stateUI.hoveredWindowId && curCommentId == window.hoveredCommentId) {
-                                    ImGui::PopStyleColor(1);
-                                }
+                                    char header[128];
+                                    snprintf(header, 128, "%*s %s %s ago [%s]", indent, "", comment.by, stateHN.timeSince(comment.time), entry.isCollapsed ? "+" : "-");
 
-                                if (stateUI.collapsed[id] == false) {
-                                    ImGui::PushTextWrapPos(ImGui::GetContentRegionAvailWidth());
-                                    ImGui::Text("%*s", indent, "");
-                                    ImGui::SameLine();
-                                    ImGui::Text("%s", comment.text.c_str());
-                                    isHovered |= ImGui::IsItemHovered();
-                                    ImGui::PopTextWrapPos();
-                                }
+                                    if (isSelected) {
+                                        auto col0 = ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled);
+                                        auto col1 = ImGui::GetStyleColorVec4(ImGuiCol_WindowBg);
+                                        ImGui::PushStyleColor(ImGuiCol_TextDisabled, col1);
+
+                                        auto p0 = ImGui::GetCursorScreenPos();
+                                        p0.x += 1 + indent;
+                                        auto p1 = p0;
+                                        p1.x += ImGui::CalcTextSize(header).x - indent;
 
-                                if (windowId == stateUI.hoveredWindowId && curCommentId == window.hoveredCommentId) {
-                                    if (ImGui::GetCursorScreenPos().y > ImGui::GetWindowSize().y + 4) {
-                                        ImGui::SetScrollHereY(1.0f);
+                                        ImGui::GetWindowDrawList()->AddRectFilled(p0, p1, ImGui::GetColorU32(col0));
                                     }
 
-                                    if (ImGui::IsMouseDoubleClicked(0) ||
-                                        ImGui::IsKeyPressed(ImGui::GetIO().KeyMap[ImGuiKey_Enter], false)) {
-                                        stateUI.collapsed[id] = !stateUI.collapsed[id];
+                                    ImGui::TextDisabled("%s", header);
+
+                                    if (isSelected) {
+                                        ImGui::PopStyleColor(1);
                                     }
+                                } else {
+                                    const auto & line = layout.lines[entry.firstLine + row.line];
+                                    ImGui::Text("%*s%.*s", indent + 1, "", (int) line.size, comment.text + line.offset);
                                 }
 
-                                if (isHovered) {
-                                    window.hoveredCommentId = curCommentId;
+                                if (ImGui::IsItemHovered()) {
+                                    window.hoveredCommentId = row.comment;
                                 }
+                            }
+                        }
 
-                                ImGui::Text("%s", "");
+                        ImGui::EndChild();
 
-                                ++curCommentId;
+                        // the comments that are still loading are wanted first if they would be on screen
+                        for (const auto & m : layout.missing) {
+                            if ((int) m.row >= rowBegin && (int) m.row <= rowEnd) {
+                                toRefreshVisible.push_back(m.id);
+                            } else {
+                                toRefresh.push_back(m.id);
+                            }
+                        }
 
-                                if (stateUI.collapsed[id] == false ) {
-                                    if (comment.kids.size() > 0) {
-                                        renderComments(comment.kids, indent + 1);
+                        if (isWindowHovered) {
+                            if (ImGui::IsKeyPressed('r', false)) {
+                                toUpdate.push_back(story.id);
+                                for (const auto & entry : layout.entries) {
+                                    if (entry.isHidden == false) {
+                                        toUpdate.push_back(entry.id);
                                     }
-                                } else {
-                                    //curCommentId += comment.kids.size();
                                 }
                             }
-                        };
 
-                        if (windowId == stateUI.hoveredWindowId) {
-                            if (ImGui::IsKeyPressed('r', false)) {
-                                toUpdate.push_back(story.id);
-                                forceUpdate = true;
+                            if (window.hoveredCommentId >= 0 && window.hoveredCommentId < nComments) {
+                                if (ImGui::IsMouseDoubleClicked(0) ||
+                                    ImGui::IsKeyPressed(ImGui::GetIO().KeyMap[ImGuiKey_Enter], false)) {
+                                    const HN::ItemId id = layout.comment(window.hoveredCommentId).id;
+                                    stateUI.collapsed[id] = !stateUI.collapsed[id];
+                                    ++stateUI.collapsedRevision;
+                                }
                             }
                         }
 
-                        ImGui::BeginChild("##comments", ImVec2(0, 0), false, ImGuiWindowFlags_NoScrollbar);
-                        renderComments(story.kids, 0);
-                        ImGui::EndChild();
-
                         if (windowId == stateUI.hoveredWindowId) {
                             if (ImGui::IsKeyPressed('k', true) ||
                                 ImGui::IsKeyPressed(ImGui::GetIO().KeyMap[ImGuiKey_UpArrow], true)) {
@@ -545,7 +580,7 @@ extern "C" {
 
                             if (ImGui::IsKeyPressed('j', true) ||
                                 ImGui::IsKeyPressed(ImGui::GetIO().KeyMap[ImGuiKey_DownArrow], true)) {
-                                window.hoveredCommentId = std::min(curCommentId - 1, window.hoveredCommentId + 1);
+                                window.hoveredCommentId = std::min(nComments - 1, window.hoveredCommentId + 1);
                             }
 
                             if (ImGui::IsKeyPressed('g', true)) {
@@ -553,7 +588,7 @@ extern "C" {
                             }
 
                             if (ImGui::IsKeyPressed('G', true)) {
-                                window.hoveredCommentId = curCommentId - 1;
+                                window.hoveredCommentId = nComments - 1;
                             }
 
                             if (ImGui::IsKeyPressed('o', false) || ImGui::IsKeyPressed('O', false)) {
@@ -569,7 +604,7 @@ extern "C" {
                             }
                         }
 
-                        window.hoveredCommentId = std::min(curCommentId - 1, window.hoveredCommentId);
+                        window.hoveredCommentId = std::min(nComments - 1, window.hoveredCommentId);
                     }
                 }
 
@@ -595,9 +630,19 @@ extern "C" {
                              ImGuiWindowFlags_NoCollapse |
                              ImGuiWindowFlags_NoResize |
                              ImGuiWindowFlags_NoMove);
-                ImGui::Text(" API requests     : %d / %d B (next update in %d s)", stateHN.nFetches, (int) stateHN.totalBytesDownloaded, stateHN.nextUpdate);
+                ImGui::Text(" API requests     : %d (+%d merged, %d cached) / %d B (next update in %d s)", stateHN.nFetches, stateHN.nMerged, stateHN.nCacheHits, (int) stateHN.totalBytesDownloaded, stateHN.nextUpdate);
                 ImGui::Text(" Last API request : %s", stateHN.curURI);
                 ImGui::Text(" Source code      : https://github.com/ggerganov/hnterm");
+                if (stateUI.showNetworkStats) {
+                    ImGui::Text(" %-12s %8s %8s %13s %12s %10s", "Endpoint", "Requests", "304 [%]", "Received [KB]", "Decoded [KB]", "Avg [ms]");
+                    for (int i = 0; i < (int) HN::Endpoint::Count; ++i) {
+                        const auto & stats = stateHN.endpointStats[i];
+                        const int n = std::max(1, stats.nRequests);
+                        ImGui::Text(" %-12s %8d %8.1f %13.1f %12.1f %10.1f", HN::kEndpointNames[i], stats.nRequests,
+                                    100.0f*stats.nNotModified/n, stats.nBytesReceived/1024.0f, stats.nBytesDecoded/1024.0f,
+                                    stats.latencySum_ms/n);
+                    }
+                }
                 ImGui::End();
             }
 
@@ -605,6 +650,11 @@ extern "C" {
                 stateUI.showStatusWindow = !stateUI.showStatusWindow;
             }
 
+            if (ImGui::IsKeyPressed('n', false)) {
+                stateUI.showNetworkStats = !stateUI.showNetworkStats;
+                stateUI.statusWindowHeight = stateUI.showNetworkStats ? 4 + 1 + (int) HN::Endpoint::Count : 4;
+            }
+
             if (ImGui::IsKeyPressed('1', false)) {
                 stateUI.nWindows = 1;
             }
@@ -653,6 +703,7 @@ extern "C" {
                 ImGui::Text(" ");
                 ImGui::Text("    h/H         - toggle Help window    ");
                 ImGui::Text("    s           - toggle Status window    ");
+                ImGui::Text("    n           - toggle network stats    ");
                 ImGui::Text("    g           - go to top    ");
                 ImGui::Text("    G           - go to end    ");
                 ImGui::Text("    o/O         - open in browser    ");
@@ -689,30 +740,63 @@ extern "C" {
 
             ImTui_ImplText_RenderDrawData(ImGui::GetDrawData(), g_screen);
 
-#ifndef __EMSCRIPTEN__
+#ifdef __EMSCRIPTEN__
+            ImTui_ImplEmscripten_DrawScreen(g_updated);
+#else
             ImTui_ImplNcurses_DrawScreen(isActive);
 #endif
 
             stateHN.forceUpdate(toUpdate);
-            g_updated = stateHN.update(toRefresh);
+            g_updated = stateHN.update(toRefreshVisible, toRefresh);
 
             return true;
         }
 }
 
 int main([[maybe_unused]] int argc, [[maybe_unused]] char ** argv) {
+    std::string cacheFname;
+    int maxParallel = 0;
+
 #ifndef __EMSCRIPTEN__
     auto argm = parseCmdArguments(argc, argv);
     int mouseSupport = argm.find("--mouse") != argm.end() || argm.find("m") != argm.end();
     if (argm.find("--help") != argm.end() || argm.find("-h") != argm.end()) {
-        printf("Usage: hnterm [-m] [-h]\n");
-        printf("    -m, --mouse : ncurses mouse support\n");
-        printf("    -h, --help  : print this help\n");
+        printf("Usage: hnterm [-m] [-bN] [-pN] [-aURI] [-cFILE] [-n] [-h]\n");
+        printf("    -m, --mouse    : ncurses mouse support\n");
+        printf("    -bN            : spend at most N ms per frame on applying received items (default: %g)\n", stateHN.updateBudget_ms);
+        printf("    -pN            : run at most N API requests in parallel (default: 32)\n");
+        printf("    -aURI          : API base URI, e.g. of hnterm-mock-server (default: %s)\n", HN::kAPIBaseDefault.c_str());
+        printf("    -cFILE         : item cache file (default: ~/.cache/hnterm.cache)\n");
+        printf("    -n, --no-cache : do not use the item cache\n");
+        printf("    -h, --help     : print this help\n");
         return -1;
     }
+    if (argm.find("b") != argm.end() && argm["b"].empty() == false) {
+        stateHN.updateBudget_ms = std::max(1.0f, (float) atof(argm["b"].c_str()));
+    }
+
+    if (argm.find("p") != argm.end() && argm["p"].empty() == false) {
+        maxParallel = atoi(argm["p"].c_str());
+    }
+
+    if (argm.find("a") != argm.end() && argm["a"].empty() == false) {
+        HN::setAPIBase(argm["a"]);
+    }
+
+    if (argm.find("c") != argm.end() && argm["c"].empty() == false) {
+        cacheFname = argm["c"];
+    } else if (const char * dir = getenv("XDG_CACHE_HOME")) {
+        cacheFname = std::string(dir) + "/hnterm.cache";
+    } else if (const char * home = getenv("HOME")) {
+        cacheFname = std::string(home) + "/.cache/hnterm.cache";
+    }
+    if (argm.find("--no-cache") != argm.end() || argm.find("n") != argm.end()) {
+        cacheFname.clear();
+    }
+
 #endif
 
-    if (hnInit() == false) {
+    if (hnInit(cacheFname.empty() ? nullptr : cacheFname.c_str(), maxParallel) == false) {
         fprintf(stderr, "Failed to initialize. Aborting\n");
         return -1;
     }
@@ -721,7 +805,8 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char ** argv) {
     ImGui::CreateContext();
 
 #ifdef __EMSCRIPTEN__
-    g_screen = ImTui_ImplEmscripten_Init(true);
+    // when no changes occured - render once per second, to refresh the times and poll for updates
+    g_screen = ImTui_ImplEmscripten_Init(true, 1.0);
 #else
     // when no changes occured - limit frame rate to 3.0 fps to save CPU
     g_screen = ImTui_ImplNcurses_Init(mouseSupport != 0, 60.0, 3.0);
@@ -730,6 +815,12 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char ** argv) {
 
     stateUI.changeColorScheme(false);
 
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+    // this is a worker thread - the backend renders the frames here and returns to the event loop in between, so
+    // that the fetch callbacks run
+    ImTui_ImplEmscripten_RunInWorker(render_frame);
+#endif
+
 #ifndef __EMSCRIPTEN__
     while (true) {
         if (render_frame() == false) break;
@@ -0,0 +1,85 @@
+/*! \file mock-server.cpp
+ *  \brief Local stand-in for the HN API - run hnterm with -ahttp://127.0.0.1:PORT to use it
+ */
+
+#include "mock-server.h"
+
+#include <csignal>
+#include <map>
+
+namespace {
+
+std::map<std::string, std::string> parseCmdArguments(int argc, char ** argv) {
+    std::map<std::string, std::string> res;
+    for (int i = 1; i < argc; ++i) {
+        res[argv[i]] = "";
+        if (argv[i][0] == '-' && strlen(argv[i]) > 1) {
+            res[std::string(1, argv[i][1])] = strlen(argv[i]) > 2 ? argv[i] + 2 : "";
+        }
+    }
+
+    return res;
+}
+
+volatile std::sig_atomic_t g_isInterrupted = 0;
+
+}
+
+int main(int argc, char ** argv) {
+    auto argm = parseCmdArguments(argc, argv);
+    if (argm.find("--help") != argm.end() || argm.find("h") != argm.end()) {
+        printf("Usage: hnterm-mock-server [-PN] [-sN] [-tN] [-lN] [-bN] [-kN] [-eN] [-dN] [-fDIR] [-h]\n");
+        printf("    -PN   : port (default: 8080)\n");
+        printf("    -sN   : number of stories (default: 500)\n");
+        printf("    -tN   : max number of comments of a story (default: 200)\n");
+        printf("    -lN   : latency of each response in ms (default: 0)\n");
+        printf("    -bN   : bandwidth per connection in KB/s (default: unlimited)\n");
+        printf("    -kN   : send the bodies chunked, in pieces of N bytes (default: not chunked)\n");
+        printf("    -eN   : respond with an error to N out of 1000 requests (default: 0)\n");
+        printf("    -dN   : drop the connection on N out of 1000 requests (default: 0)\n");
+        printf("    -fDIR : serve the files in DIR, e.g. DIR/v0/item/123.json, instead of the generated items\n");
+        printf("    -h    : print this help\n");
+        return -1;
+    }
+
+    MockServer::Config config;
+    config.port = 8080;
+
+    auto arg = [&](const char * name, int & val) {
+        if (argm.find(name) != argm.end() && argm[name].empty() == false) {
+            val = atoi(argm[name].c_str());
+        }
+    };
+
+    arg("P", config.port);
+    arg("s", config.nStories);
+    arg("t", config.maxThreadSize);
+    arg("l", config.latency_ms);
+    arg("b", config.bandwidth_KBps);
+    arg("k", config.chunkSize);
+    arg("e", config.errorsPerMille);
+    arg("d", config.dropsPerMille);
+    if (argm.find("f") != argm.end()) {
+        config.fixtureDir = argm["f"];
+    }
+
+    MockServer server;
+    if (server.start(config) == false) {
+        fprintf(stderr, "Failed to listen on port %d\n", config.port);
+        return -1;
+    }
+
+    printf("Serving %d stories on %s\n", config.nStories, server.baseURI().c_str());
+
+    std::signal(SIGINT, [](int) { g_isInterrupted = 1; });
+    while (g_isInterrupted == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    server.stop();
+
+    printf("\nRequests: %d (%d not modified, %d failed), sent: %d B\n",
+           (int) server.nRequests, (int) server.nNotModified, (int) server.nErrors, (int) server.nBytesSent);
+
+    return 0;
+}
@@ -0,0 +1,544 @@
+/*! \file mock-server.h
+ *  \brief Local stand-in for the HN API
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Serves the HN API endpoints that hnterm uses over HTTP/1.1 on the loopback interface:
+//
+//   /v0/{top,new,ask,show,job}stories.json
+//   /v0/item/N.json
+//   /v0/updates.json
+//
+// The items are generated from a seed on start(), so every run sees the same corpus: stories with comment threads
+// of varying size and depth, texts with the HTML markup and entities of the real API. The first story in
+// topstories.json has the largest thread. Files in Config::fixtureDir take precedence over the generated responses,
+// e.g. DIR/v0/item/123.json, so recorded responses can be served as well.
+//
+// Every response carries an ETag and conditional requests are answered with "304 Not Modified". Latency, bandwidth,
+// chunked transfer encoding and failed requests can be injected. Each connection is served by its own thread.
+struct MockServer {
+    struct Config {
+        int port = 0;                // 0 - any free port
+        uint32_t seed = 1;
+
+        int nStories = 500;
+        int maxThreadSize = 200;     // comments under a story - the top story gets twice as many
+        int maxDepth = 8;
+
+        std::string fixtureDir = ""; // overrides the generated responses
+
+        int latency_ms = 0;          // added before each response
+        int bandwidth_KBps = 0;      // per connection, 0 - unlimited
+        int chunkSize = 0;           // 0 - send the bodies with Content-Length, otherwise chunked in pieces this big
+        int errorsPerMille = 0;      // answered with "503 Service Unavailable"
+        int dropsPerMille = 0;       // the connection is closed without a response
+
+        int updatePeriod_s = 30;     // the scores of the top stories change this often
+        int nUpdated = 10;
+    };
+
+    ~MockServer() { stop(); }
+
+    bool start(const Config & config) {
+        stop();
+
+        this->config = config;
+        generate();
+
+        fdListen = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fdListen < 0) {
+            return false;
+        }
+
+        const int one = 1;
+        setsockopt(fdListen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(config.port);
+
+        socklen_t addrSize = sizeof(addr);
+        if (::bind(fdListen, (sockaddr *) &addr, sizeof(addr)) != 0 || ::listen(fdListen, 64) != 0 ||
+            getsockname(fdListen, (sockaddr *) &addr, &addrSize) != 0) {
+            ::close(fdListen);
+            fdListen = -1;
+            return false;
+        }
+        curPort = ntohs(addr.sin_port);
+
+        isRunning = true;
+        acceptor = std::thread([this]() { runAcceptor(); });
+
+        return true;
+    }
+
+    void stop() {
+        isRunning = false;
+        if (acceptor.joinable()) {
+            acceptor.join();
+        }
+
+        std::list<Connection> tmp;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tmp.swap(connections);
+        }
+        for (auto & c : tmp) {
+            c.thread.join();
+        }
+
+        if (fdListen >= 0) {
+            ::close(fdListen);
+        }
+        fdListen = -1;
+    }
+
+    int port() const {
+        return curPort;
+    }
+
+    // pass to HN::setAPIBase()
+    std::string baseURI() const {
+        return "http://127.0.0.1:" + std::to_string(curPort);
+    }
+
+    // in the order of topstories.json
+    const std::vector<int> & topStories() const {
+        return storyIds;
+    }
+
+    std::atomic<uint64_t> nRequests = 0;
+    std::atomic<uint64_t> nNotModified = 0;
+    std::atomic<uint64_t> nErrors = 0;       // injected errors and drops
+    std::atomic<uint64_t> nBytesSent = 0;    // headers and bodies
+
+    private:
+    struct GeneratedItem {
+        int parent = 0;      // 0 for stories
+        int depth = 0;
+        int descendants = 0; // stories only
+        std::vector<int> kids;
+    };
+
+    // splitmix64 - the corpus depends only on the seed
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27))*0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t rnd(uint64_t a, uint64_t b = 0) const {
+        return mix(mix(config.seed ^ (a << 20)) ^ b);
+    }
+
+    void generate() {
+        items.clear();
+        storyIds.clear();
+
+        int nextId = 1000;
+        for (int s = 0; s < config.nStories; ++s) {
+            const int storyId = nextId++;
+            storyIds.push_back(storyId);
+            items[storyId] = {};
+
+            int nComments = config.maxThreadSize > 0 ? rnd(storyId)%(config.maxThreadSize + 1) : 0;
+            if (s == 0) {
+                nComments = 2*config.maxThreadSize;
+            }
+
+            // attach each comment to the story or to an earlier comment of the thread, preferring recent ones, so
+            // the threads get deep as well as wide
+            std::vector<int> thread = { storyId };
+            for (int c = 0; c < nComments; ++c) {
+                const int id = nextId++;
+
+                int parent = storyId;
+                const uint64_t r = rnd(id, 1);
+                if (r%4 != 0) {
+                    parent = thread[thread.size() - 1 - (r >> 8)%std::min<size_t>(thread.size(), 8)];
+                }
+                if (items[parent].depth >= config.maxDepth) {
+                    parent = storyId;
+                }
+
+                auto & item = items[id];
+                item.parent = parent;
+                item.depth = items[parent].depth + 1;
+                items[parent].kids.push_back(id);
+
+                thread.push_back(id);
+            }
+
+            items[storyId].descendants = nComments;
+        }
+    }
+
+    static void appendText(std::string & dst, uint64_t r, int nWords) {
+        static const char * kWords[] = {
+            "the", "of", "and", "a", "to", "in", "is", "you", "that", "it", "compiler", "latency", "memory",
+            "terminal", "I&#x27;m", "don&#x27;t", "&quot;fast&quot;", "x &gt; y", "a &amp; b", "cache", "thread",
+            "kernel", "rust", "C++", "startup", "database", "browser", "server", "queue", "&lt;vector&gt;",
+        };
+        const int nKinds = sizeof(kWords)/sizeof(kWords[0]);
+
+        for (int i = 0; i < nWords; ++i) {
+            r = mix(r);
+            if (i > 0) {
+                dst += (r%17 == 0) ? "<p>" : " ";
+            }
+            if (r%53 == 0) {
+                dst += "<a href=\\\"https:&#x2F;&#x2F;example.com&#x2F;\\\" rel=\\\"nofollow\\\">https:&#x2F;&#x2F;example.com&#x2F;</a>";
+            } else {
+                dst += kWords[(r >> 16)%nKinds];
+            }
+        }
+    }
+
+    // a changed score is reported through updates.json
+    int epoch() const {
+        const auto t = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        return config.updatePeriod_s > 0 ? t/config.updatePeriod_s : 0;
+    }
+
+    bool itemJSON(int id, std::string & res) const {
+        const auto it = items.find(id);
+        if (it == items.end()) {
+            return false;
+        }
+        const auto & item = it->second;
+
+        const uint64_t r = rnd(id, 2);
+
+        res = "{\"by\":\"user";
+        res += std::to_string(r%5000);
+        res += "\",\"id\":";
+        res += std::to_string(id);
+
+        if (item.kids.empty() == false) {
+            res += ",\"kids\":[";
+            for (size_t i = 0; i < item.kids.size(); ++i) {
+                if (i > 0) res += ',';
+                res += std::to_string(item.kids[i]);
+            }
+            res += ']';
+        }
+
+        if (item.parent == 0) {
+            const int rank = std::find(storyIds.begin(), storyIds.end(), id) - storyIds.begin();
+            int score = 1 + (r >> 8)%500;
+            if (rank < config.nUpdated) {
+                score += epoch()%1000;
+            }
+
+            res += ",\"descendants\":" + std::to_string(item.descendants);
+            res += ",\"score\":" + std::to_string(score);
+            res += ",\"time\":" + std::to_string(1600000000 + id);
+            res += ",\"title\":\"";
+            appendText(res, r, 4 + (r >> 12)%8);
+            res += "\",\"type\":\"story\",\"url\":\"https://example.com/";
+            res += std::to_string(id);
+            res += "\"}";
+        } else {
+            res += ",\"parent\":" + std::to_string(item.parent);
+            res += ",\"text\":\"";
+            appendText(res, r, 8 + (r >> 12)%120);
+            res += "\",\"time\":" + std::to_string(1600000000 + id);
+            res += ",\"type\":\"comment\"}";
+        }
+
+        return true;
+    }
+
+    static std::string idsJSON(const std::vector<int> & ids) {
+        std::string res = "[";
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (i > 0) res += ',';
+            res += std::to_string(ids[i]);
+        }
+        res += ']';
+
+        return res;
+    }
+
+    bool fixture(const std::string & path, std::string & res) const {
+        if (config.fixtureDir.empty()) {
+            return false;
+        }
+
+        // only the files in the fixture directory
+        if (path.find("..") != std::string::npos) {
+            return false;
+        }
+
+        FILE * f = fopen((config.fixtureDir + path).c_str(), "rb");
+        if (f == nullptr) {
+            return false;
+        }
+
+        res.clear();
+        char buf[16*1024];
+        size_t n = 0;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            res.append(buf, n);
+        }
+        fclose(f);
+
+        return true;
+    }
+
+    // returns false for unknown paths
+    bool body(const std::string & path, std::string & res) const {
+        if (fixture(path, res)) {
+            return true;
+        }
+
+        static const std::string kItemPrefix = "/v0/item/";
+        if (path.compare(0, kItemPrefix.size(), kItemPrefix) == 0) {
+            return itemJSON(atoi(path.c_str() + kItemPrefix.size()), res);
+        }
+
+        std::vector<int> ids;
+        if (path == "/v0/topstories.json") {
+            ids = storyIds;
+        } else if (path == "/v0/newstories.json") {
+            ids = storyIds;
+            std::sort(ids.begin(), ids.end(), [](int a, int b) { return a > b; });
+        } else if (path == "/v0/askstories.json" || path == "/v0/showstories.json" || path == "/v0/jobstories.json") {
+            const int k = path[4] == 'a' ? 7 : path[4] == 's' ? 11 : 13;
+            for (size_t i = 0; i < storyIds.size(); i += k) {
+                ids.push_back(storyIds[i]);
+            }
+        } else if (path == "/v0/updates.json") {
+            ids.assign(storyIds.begin(), storyIds.begin() + std::min<size_t>(config.nUpdated, storyIds.size()));
+            res = "{\"items\":" + idsJSON(ids) + ",\"profiles\":[]}";
+            return true;
+        } else {
+            return false;
+        }
+
+        res = idsJSON(ids);
+
+        return true;
+    }
+
+    static std::string etagOf(std::string_view body) {
+        uint64_t h = 1469598103934665603ull;
+        for (auto ch : body) {
+            h = (h ^ uint8_t(ch))*1099511628211ull;
+        }
+
+        char buf[32];
+        snprintf(buf, sizeof(buf), "\"%016llx\"", (unsigned long long) h);
+
+        return buf;
+    }
+
+    // send everything, at most at the configured bandwidth
+    bool sendAll(int fd, std::string_view data) {
+        while (data.empty() == false) {
+            size_t n = data.size();
+            if (config.bandwidth_KBps > 0) {
+                n = std::min<size_t>(n, std::max(1, config.bandwidth_KBps*1024/100)); // 10 ms worth
+            }
+
+            const ssize_t k = ::send(fd, data.data(), n, MSG_NOSIGNAL);
+            if (k <= 0) {
+                return false;
+            }
+
+            nBytesSent += k;
+            data.remove_prefix(k);
+
+            if (config.bandwidth_KBps > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(1000000*k/(1024*config.bandwidth_KBps)));
+            }
+        }
+
+        return true;
+    }
+
+    bool respond(int fd, const std::string & request) {
+        const size_t eol = request.find("\r\n");
+        const size_t sp0 = request.find(' ');
+        const size_t sp1 = request.find(' ', sp0 + 1);
+        if (eol == std::string::npos || sp0 == std::string::npos || sp1 == std::string::npos || sp1 > eol) {
+            return false;
+        }
+
+        const std::string path = request.substr(sp0 + 1, sp1 - sp0 - 1);
+
+        std::string ifNoneMatch;
+        for (size_t pos = eol + 2; pos < request.size(); ) {
+            const size_t end = request.find("\r\n", pos);
+            if (end == std::string::npos || end == pos) break;
+
+            static const char kHeader[] = "if-none-match:";
+            if (end - pos > sizeof(kHeader) - 1 && strncasecmp(request.c_str() + pos, kHeader, sizeof(kHeader) - 1) == 0) {
+                size_t begin = pos + sizeof(kHeader) - 1;
+                while (begin < end && request[begin] == ' ') ++begin;
+                ifNoneMatch = request.substr(begin, end - begin);
+            }
+
+            pos = end + 2;
+        }
+
+        ++nRequests;
+
+        if (config.latency_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(config.latency_ms));
+        }
+
+        const uint64_t r = mix(nRequests ^ (uint64_t(config.seed) << 32));
+        if (int(r%1000) < config.dropsPerMille) {
+            ++nErrors;
+            return false;
+        }
+
+        std::string status = "200 OK";
+        std::string content;
+        std::string etag;
+        if (int((r >> 16)%1000) < config.errorsPerMille) {
+            ++nErrors;
+            status = "503 Service Unavailable";
+        } else if (body(path, content) == false) {
+            status = "404 Not Found";
+            content = "null";
+        } else {
+            etag = etagOf(content);
+            if (etag == ifNoneMatch) {
+                ++nNotModified;
+                status = "304 Not Modified";
+                content.clear();
+            }
+        }
+
+        const bool isChunked = config.chunkSize > 0 && content.empty() == false;
+
+        std::string header = "HTTP/1.1 " + status + "\r\nContent-Type: application/json; charset=utf-8\r\n";
+        if (etag.empty() == false) {
+            header += "ETag: " + etag + "\r\n";
+        }
+        if (isChunked) {
+            header += "Transfer-Encoding: chunked\r\n\r\n";
+        } else {
+            header += "Content-Length: " + std::to_string(content.size()) + "\r\n\r\n";
+        }
+
+        if (isChunked == false) {
+            return sendAll(fd, header + content);
+        }
+
+        if (sendAll(fd, header) == false) {
+            return false;
+        }
+        for (size_t pos = 0; pos < content.size(); pos += config.chunkSize) {
+            const size_t n = std::min<size_t>(config.chunkSize, content.size() - pos);
+
+            char size[32];
+            snprintf(size, sizeof(size), "%zx\r\n", n);
+            if (sendAll(fd, std::string(size) + content.substr(pos, n) + "\r\n") == false) {
+                return false;
+            }
+        }
+
+        return sendAll(fd, "0\r\n\r\n");
+    }
+
+    struct Connection {
+        std::thread thread;
+        std::atomic<bool> isDone = false;
+    };
+
+    void runConnection(int fd, Connection & connection) {
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::string buf;
+        char tmp[4096];
+        while (isRunning) {
+            pollfd pfd = { fd, POLLIN, 0 };
+            if (::poll(&pfd, 1, 100) <= 0) continue;
+
+            const ssize_t n = ::recv(fd, tmp, sizeof(tmp), 0);
+            if (n <= 0) break;
+            buf.append(tmp, n);
+
+            // the requests have no bodies
+            size_t end;
+            bool isOk = true;
+            while (isOk && (end = buf.find("\r\n\r\n")) != std::string::npos) {
+                isOk = respond(fd, buf.substr(0, end + 4));
+                buf.erase(0, end + 4);
+            }
+            if (isOk == false) break;
+        }
+
+        ::close(fd);
+
+        connection.isDone = true;
+    }
+
+    void runAcceptor() {
+        while (isRunning) {
+            pollfd pfd = { fdListen, POLLIN, 0 };
+            if (::poll(&pfd, 1, 100) <= 0) continue;
+
+            const int fd = ::accept(fdListen, nullptr, nullptr);
+            if (fd < 0) continue;
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // join the threads of the closed connections
+            for (auto it = connections.begin(); it != connections.end(); ) {
+                if (it->isDone) {
+                    it->thread.join();
+                    it = connections.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            auto & connection = connections.emplace_back();
+            connection.thread = std::thread([this, fd, &connection]() { runConnection(fd, connection); });
+        }
+    }
+
+    Config config;
+
+    std::unordered_map<int, GeneratedItem> items;
+    std::vector<int> storyIds;
+
+    int fdListen = -1;
+    int curPort = 0;
+
+    std::atomic<bool> isRunning = false;
+    std::thread acceptor;
+
+    std::mutex mutex; // connections
+    std::list<Connection> connections;
+};
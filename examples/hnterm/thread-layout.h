@@ -0,0 +1,249 @@
+/*! \file thread-layout.h
+ *  \brief Flattened layout of the comment tree of a story
+ */
+
+#pragma once
+
+#include "hn-state.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <unordered_set>
+#include <vector>
+
+namespace HN {
+
+// The comments of a story in pre-order, with the texts already wrapped into lines. Rendering is a linear pass over
+// the rows, so only the ones on screen need to be submitted. The layout is updated only when items are received,
+// a comment is collapsed or expanded, or the width changes - the unchanged parts of the tree are copied as they are.
+struct ThreadLayout {
+    // [offset, offset + size) in the text of the comment
+    struct Line {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    struct Entry {
+        ItemId id = 0;
+        int depth = 0;
+        bool isLoaded = false;    // the comment has been received
+        bool isCollapsed = false;
+        bool isHidden = false;    // a parent is collapsed
+
+        uint32_t firstLine = 0;
+        uint32_t nLines = 0;
+    };
+
+    // a line on screen: the header of the comment (-1), a line of its text, or the empty line after it (nLines)
+    struct Row {
+        uint32_t comment = 0;
+        int32_t line = 0;
+    };
+
+    ItemId storyId = 0;
+
+    std::vector<Entry> entries;
+    std::vector<Line> lines;
+
+    // the visible comments - index in "entries" and first row
+    std::vector<uint32_t> comments;
+    std::vector<uint32_t> commentRows;
+    std::vector<Row> rows;
+
+    // comments that are not hidden, but have not been received yet - and the row they will appear at
+    struct Missing {
+        ItemId id = 0;
+        uint32_t row = 0;
+    };
+
+    std::vector<Missing> missing;
+
+    const Entry & comment(int i) const { return entries[comments[i]]; }
+
+    // returns true if the rows have changed
+    bool update(const State & state, ItemId storyId, int width, const std::map<int, bool> & collapsed, int collapsedRevision) {
+        // the items received in the frames this layout was not updated are not known - start over
+        const uint64_t nNew = state.nReceived - nReceived;
+        bool isReset = storyId != this->storyId || width != this->width || (nNew > 0 && nNew != state.received.size());
+
+        changed.clear();
+        if (isReset == false && nNew > 0) {
+            changed.insert(state.received.begin(), state.received.end());
+            isReset = changed.count(storyId) > 0;
+        }
+
+        nReceived = state.nReceived;
+
+        if (isReset) {
+            this->storyId = storyId;
+            this->width = width;
+
+            entries.clear();
+            lines.clear();
+
+            const Item * story = state.findItem(storyId);
+            if (story && story->type == ItemType::Story) {
+                add(state, state.getStory(*story).kids, 0, entries, lines);
+            }
+        } else if (refresh(state) == false && collapsedRevision == this->collapsedRevision) {
+            return false;
+        }
+
+        this->collapsedRevision = collapsedRevision;
+
+        for (auto & entry : entries) {
+            const auto it = collapsed.find(entry.id);
+            entry.isCollapsed = it != collapsed.end() && it->second;
+        }
+
+        updateRows();
+
+        return true;
+    }
+
+    private:
+    int width = 0;
+    uint64_t nReceived = 0;
+    int collapsedRevision = -1;
+
+    std::unordered_set<ItemId> changed;
+    std::vector<Entry> newEntries;
+    std::vector<Line> newLines;
+
+    // add the comments "ids" and all their replies
+    void add(const State & state, Kids ids, int depth, std::vector<Entry> & dstEntries, std::vector<Line> & dstLines) const {
+        std::vector<std::pair<ItemId, int>> stack;
+        for (size_t i = ids.size(); i > 0; --i) {
+            stack.push_back({ ids[i - 1], depth });
+        }
+
+        while (stack.empty() == false) {
+            Entry entry;
+            entry.id = stack.back().first;
+            entry.depth = stack.back().second;
+            entry.firstLine = dstLines.size();
+            stack.pop_back();
+
+            const Item * item = state.findItem(entry.id);
+            if (item && item->type == ItemType::Comment) {
+                const CommentView comment = state.getComment(*item);
+
+                entry.isLoaded = true;
+                entry.nLines = wrap(comment.text, std::max(8, width - entry.depth - 1), dstLines);
+
+                for (size_t i = comment.kids.size(); i > 0; --i) {
+                    stack.push_back({ comment.kids[i - 1], entry.depth + 1 });
+                }
+            }
+
+            dstEntries.push_back(entry);
+        }
+    }
+
+    // rebuild the subtrees of the received comments, copy the rest - returns false if none of them is in the thread
+    bool refresh(const State & state) {
+        if (changed.empty() || std::none_of(entries.begin(), entries.end(), [&](const Entry & e) { return changed.count(e.id) > 0; })) {
+            return false;
+        }
+
+        newEntries.clear();
+        newLines.clear();
+
+        const size_t n = entries.size();
+        for (size_t i = 0; i < n; ) {
+            const Entry & entry = entries[i];
+            if (changed.count(entry.id) == 0) {
+                newEntries.push_back(entry);
+                newEntries.back().firstLine = newLines.size();
+                newLines.insert(newLines.end(), lines.begin() + entry.firstLine, lines.begin() + entry.firstLine + entry.nLines);
+                ++i;
+                continue;
+            }
+
+            const ItemId id = entry.id;
+            add(state, { &id, 1 }, entry.depth, newEntries, newLines);
+
+            const int depth = entry.depth;
+            for (++i; i < n && entries[i].depth > depth; ++i) {}
+        }
+
+        entries.swap(newEntries);
+        lines.swap(newLines);
+
+        return true;
+    }
+
+    void updateRows() {
+        comments.clear();
+        commentRows.clear();
+        rows.clear();
+        missing.clear();
+
+        int collapsedDepth = -1;
+        for (uint32_t i = 0; i < entries.size(); ++i) {
+            auto & entry = entries[i];
+            entry.isHidden = collapsedDepth >= 0 && entry.depth > collapsedDepth;
+            if (entry.isHidden) continue;
+
+            collapsedDepth = entry.isCollapsed ? entry.depth : -1;
+            if (entry.isLoaded == false) {
+                missing.push_back({ entry.id, (uint32_t) rows.size() });
+                continue;
+            }
+
+            const uint32_t comment = comments.size();
+            comments.push_back(i);
+            commentRows.push_back(rows.size());
+
+            rows.push_back({ comment, -1 });
+            if (entry.isCollapsed == false) {
+                for (uint32_t k = 0; k < entry.nLines; ++k) {
+                    rows.push_back({ comment, (int32_t) k });
+                }
+            }
+            rows.push_back({ comment, (int32_t) entry.nLines });
+        }
+    }
+
+    // Word-wrap the text into lines of at most "width" cells - one cell per codepoint, like the text backend. Returns
+    // the number of lines, which is at least 1.
+    static uint32_t wrap(const char * text, int width, std::vector<Line> & dst) {
+        const size_t first = dst.size();
+
+        const char * p = text;
+        while (true) {
+            const char * lineBegin = p;
+            const char * lastSpace = nullptr;
+            int nCells = 0;
+
+            while (*p != 0 && *p != '\n' && nCells < width) {
+                if (*p == ' ') lastSpace = p;
+                ++p;
+                while ((*p & 0xC0) == 0x80) ++p;
+                ++nCells;
+            }
+
+            // break after the last space, unless the word does not fit on a line by itself
+            if (*p != 0 && *p != '\n' && *p != ' ' && lastSpace) {
+                p = lastSpace + 1;
+            }
+
+            const char * lineEnd = p;
+            while (lineEnd > lineBegin && lineEnd[-1] == ' ') --lineEnd;
+            dst.push_back({ uint32_t(lineBegin - text), uint32_t(lineEnd - lineBegin) });
+
+            if (*p == 0) break;
+            if (*p == '\n') {
+                ++p;
+            } else {
+                while (*p == ' ') ++p;
+                if (*p == 0) break;
+            }
+        }
+
+        return dst.size() - first;
+    }
+};
+
+}
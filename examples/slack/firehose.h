@@ -0,0 +1,175 @@
+/*! \file firehose.h
+ *  \brief Synthetic message load generator
+ */
+
+#pragma once
+
+#include "spsc-queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+// fixed-width buckets - the last one collects everything above the range
+// the counts are floats, so they can be passed directly to ImGui::PlotHistogram()
+struct Histogram {
+    Histogram(int nBuckets, float bucket_ms) : counts(nBuckets, 0.0f), bucket_ms(bucket_ms) {}
+
+    void add(float ms) {
+        const int i = std::min((int) (ms/bucket_ms), (int) counts.size() - 1);
+        counts[i] += 1.0f;
+
+        ++n;
+        max_ms = std::max(max_ms, ms);
+    }
+
+    // upper edge of the bucket that contains the p-th percentile, p in [0, 1]
+    float percentile(float p) const {
+        if (n == 0) return 0.0f;
+
+        const float target = p*n;
+        float sum = 0.0f;
+        for (int i = 0; i < (int) counts.size(); ++i) {
+            sum += counts[i];
+            if (sum >= target) {
+                return std::min((i + 1)*bucket_ms, max_ms);
+            }
+        }
+
+        return max_ms;
+    }
+
+    void reset() {
+        std::fill(counts.begin(), counts.end(), 0.0f);
+        n = 0;
+        max_ms = 0.0f;
+    }
+
+    std::vector<float> counts;
+    float bucket_ms;
+
+    uint64_t n = 0;
+    float max_ms = 0.0f;
+};
+
+struct FirehoseMessage {
+    int32_t channel;
+    int32_t uid;
+    int32_t logId;      // row in the sample log corpus
+    bool    isMention;  // addressed to the local user
+
+    int64_t tArrival_us;
+};
+
+// Generates channel messages at a given rate on a background thread and passes them to the UI thread through a
+// lock-free queue. The message bodies are not generated - they refer to the sample logs. Like the randomly generated
+// workspace, each channel walks through the logs, jumping to a random place from time to time.
+//
+// Without threads (Emscripten), produce() is called from the main loop instead.
+struct Firehose {
+    static constexpr int kQueueSizeLog2 = 17;
+
+    ~Firehose() { stop(); }
+
+    static int64_t t_us() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void start(int nChannels, int nUsers, int nLogs) {
+        stop();
+
+        this->nChannels = nChannels;
+        this->nUsers    = nUsers;
+        this->nLogs     = nLogs;
+
+        logIds.resize(nChannels);
+        for (auto & logId : logIds) {
+            logId = 1 + rng()%(nLogs - 1);
+        }
+
+        tLast_us = t_us();
+        credit = 0.0;
+
+        isRunning = true;
+
+#ifndef __EMSCRIPTEN__
+        worker = std::thread([this]() {
+            while (isRunning) {
+                produce(t_us());
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+#endif
+    }
+
+    void stop() {
+        isRunning = false;
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    // queue the messages that are due by tNow_us
+    void produce(int64_t tNow_us) {
+        // do not try to catch up after a stall longer than 100 ms
+        credit = std::min(credit + 1e-6*rate*(tNow_us - tLast_us), 0.1*rate + 1.0);
+        tLast_us = tNow_us;
+
+        while (credit >= 1.0) {
+            credit -= 1.0;
+
+            FirehoseMessage msg;
+            msg.channel = rng()%nChannels;
+            msg.uid     = rng()%nUsers;
+
+            auto & logId = logIds[msg.channel];
+            logId = (rng()%32 == 0) ? 1 + rng()%(nLogs - 1) : std::max((logId + 1)%nLogs, 1);
+            msg.logId = logId;
+
+            msg.isMention = int(rng()%1000) < mentionsPerMille;
+            msg.tArrival_us = tNow_us;
+
+            if (queue.push(msg)) {
+                ++nProduced;
+            } else {
+                ++nDropped;
+            }
+        }
+    }
+
+    bool pop(FirehoseMessage & msg) {
+        return queue.pop(msg);
+    }
+
+    int nQueued() const {
+        return queue.size();
+    }
+
+    std::atomic<bool> isRunning = false;
+
+    std::atomic<int> rate = 1000; // messages per second
+    std::atomic<int> mentionsPerMille = 5;
+
+    std::atomic<uint64_t> nProduced = 0;
+    std::atomic<uint64_t> nDropped  = 0;
+
+    private:
+    int nChannels = 0;
+    int nUsers    = 0;
+    int nLogs     = 0;
+
+    std::vector<int> logIds; // current position of each channel in the logs
+
+    int64_t tLast_us = 0;
+    double credit = 0.0;
+
+    std::mt19937 rng;
+
+    std::thread worker;
+
+    SpscQueue<FirehoseMessage> queue { kQueueSizeLog2 };
+};
@@ -0,0 +1,364 @@
+/*! \file log-loader.h
+ *  \brief Streaming chat log ingestion
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define SLACK_LOG_LOADER_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+// append "src" to "dst", replacing the characters that we cannot display, because we only support single-byte strings
+inline void appendSanitized(std::string & dst, std::string_view src) {
+    for (auto ch : src) {
+        if (ch < 32) {
+            dst += "@";
+        } else if (ch == '<') {
+            dst += "@lt;";
+        } else if (ch == '>') {
+            dst += "@gt;";
+        } else if (ch == '&') {
+            dst += "@amp;";
+        } else {
+            dst += ch;
+        }
+    }
+}
+
+// single chat line
+// channel and username point inside the mapped log file, the body is stored sanitized in LogBatch::text
+struct LogRecord {
+    int32_t t_s; // timestamp in seconds, 0 if missing
+
+    uint32_t textBegin;
+    uint32_t textSize;
+
+    std::string_view channel;
+    std::string_view username;
+};
+
+struct LogBatch {
+    std::string text;
+    std::vector<LogRecord> records;
+
+    inline std::string_view getText(const LogRecord & record) const { return { text.data() + record.textBegin, record.textSize }; }
+};
+
+// Memory-maps a chat log and parses it line by line on a background thread. The parsed lines are published in
+// batches which the UI thread collects with poll() and appends to the message stores at its own pace.
+//
+// Supported line formats:
+//
+//   JSONL : {"channel": "general", "t": 1658500000, "username": "ggerganov", "text": "hello"}
+//           all fields except "text" are optional
+//
+//   TSV   : username<TAB>text
+//           channel<TAB>t<TAB>username<TAB>text
+//
+struct LogLoader {
+    static constexpr int kBatchSize = 4096;
+
+    ~LogLoader() { close(); }
+
+    bool open(const char * fname) {
+        close();
+
+#ifdef SLACK_LOG_LOADER_MMAP
+        fd = ::open(fname, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close();
+            return false;
+        }
+
+        size = st.st_size;
+        if (size > 0) {
+            void * ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr == MAP_FAILED) {
+                close();
+                return false;
+            }
+            madvise(ptr, size, MADV_SEQUENTIAL);
+            data = (const char *) ptr;
+        }
+#else
+        std::ifstream fin(fname, std::ios::binary);
+        if (fin.is_open() == false) {
+            return false;
+        }
+        buffer.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+#endif
+
+        isDone = false;
+        worker = std::thread([this]() { run(); });
+
+        return true;
+    }
+
+    void close() {
+        stop = true;
+        if (worker.joinable()) {
+            worker.join();
+        }
+        stop = false;
+
+        pending.clear();
+
+#ifdef SLACK_LOG_LOADER_MMAP
+        if (data) {
+            munmap((void *) data, size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+#else
+        buffer.clear();
+#endif
+
+        data = nullptr;
+        size = 0;
+        nLines = 0;
+        nBytesIndexed = 0;
+    }
+
+    // true while there are lines that have not been collected yet
+    bool isLoading() const {
+        if (data == nullptr) return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return isDone == false || pending.empty() == false;
+    }
+
+    // take the next batch of parsed lines, returns false if there is nothing new
+    bool poll(LogBatch & res) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.empty()) {
+            return false;
+        }
+
+        res = std::move(pending.front());
+        pending.pop_front();
+
+        return true;
+    }
+
+    float progress() const {
+        return size > 0 ? float(nBytesIndexed)/size : 1.0f;
+    }
+
+    std::atomic<int> nLines = 0;
+    std::atomic<uint64_t> nBytesIndexed = 0;
+
+    private:
+    void run() {
+        LogBatch batch;
+
+        size_t pos = 0;
+        while (pos < size && stop == false) {
+            const char * eol = (const char *) memchr(data + pos, '\n', size - pos);
+            const size_t end = eol ? eol - data : size;
+
+            std::string_view line(data + pos, end - pos);
+            if (line.size() > 0 && line.back() == '\r') {
+                line.remove_suffix(1);
+            }
+
+            if (line.empty() == false) {
+                parseLine(line, batch);
+            }
+
+            pos = end + 1;
+
+            if ((int) batch.records.size() >= kBatchSize) {
+                nBytesIndexed = pos;
+                publish(batch);
+            }
+        }
+
+        nBytesIndexed = size;
+        publish(batch);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        isDone = true;
+    }
+
+    void publish(LogBatch & batch) {
+        if (batch.records.empty()) return;
+
+        nLines += batch.records.size();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(batch));
+        batch = {};
+        batch.records.reserve(kBatchSize);
+    }
+
+    static void parseLine(std::string_view line, LogBatch & batch) {
+        LogRecord record = {};
+
+        std::string_view text;
+
+        if (line[0] == '{') {
+            std::string_view key;
+            std::string_view val;
+
+            size_t pos = 1;
+            while (parseJSONField(line, pos, key, val)) {
+                if (key == "text") {
+                    text = val;
+                } else if (key == "username") {
+                    record.username = val;
+                } else if (key == "channel") {
+                    record.channel = val;
+                } else if (key == "t") {
+                    record.t_s = parseInt(val);
+                }
+            }
+
+            record.textBegin = batch.text.size();
+            appendSanitizedJSON(batch.text, text);
+        } else {
+            std::string_view cols[4];
+
+            int n = 0;
+            while (n < 3) {
+                const auto tab = line.find('\t');
+                if (tab == std::string_view::npos) break;
+                cols[n++] = line.substr(0, tab);
+                line.remove_prefix(tab + 1);
+            }
+            cols[n++] = line;
+
+            if (n == 4) {
+                record.channel  = cols[0];
+                record.t_s      = parseInt(cols[1]);
+                record.username = cols[2];
+                text            = cols[3];
+            } else if (n == 2) {
+                record.username = cols[0];
+                text            = cols[1];
+            } else {
+                text = cols[n - 1];
+            }
+
+            record.textBegin = batch.text.size();
+            appendSanitized(batch.text, text);
+        }
+
+        record.textSize = batch.text.size() - record.textBegin;
+        batch.records.push_back(record);
+    }
+
+    // parse the next "key": value pair of a flat JSON object, starting at "pos"
+    // string values are returned without the quotes and still escaped
+    static bool parseJSONField(std::string_view json, size_t & pos, std::string_view & key, std::string_view & val) {
+        const size_t n = json.size();
+
+        auto skipSpaces = [&]() { while (pos < n && (json[pos] == ' ' || json[pos] == ',' || json[pos] == '\t')) ++pos; };
+        auto parseString = [&](std::string_view & res) {
+            if (pos >= n || json[pos] != '"') return false;
+            const size_t begin = ++pos;
+            while (pos < n && json[pos] != '"') {
+                pos += json[pos] == '\\' ? 2 : 1;
+            }
+            if (pos >= n) return false;
+            res = json.substr(begin, pos - begin);
+            ++pos;
+            return true;
+        };
+
+        skipSpaces();
+        if (parseString(key) == false) return false;
+
+        while (pos < n && (json[pos] == ' ' || json[pos] == ':')) ++pos;
+        if (pos >= n) return false;
+
+        if (json[pos] == '"') {
+            return parseString(val);
+        }
+
+        const size_t begin = pos;
+        while (pos < n && json[pos] != ',' && json[pos] != '}') ++pos;
+        val = json.substr(begin, pos - begin);
+
+        return true;
+    }
+
+    static void appendSanitizedJSON(std::string & dst, std::string_view src) {
+        for (size_t i = 0; i < src.size(); ++i) {
+            if (src[i] != '\\' || i + 1 == src.size()) {
+                appendSanitized(dst, src.substr(i, 1));
+                continue;
+            }
+
+            switch (src[++i]) {
+                case '"':  dst += '"'; break;
+                case '\\': dst += '\\'; break;
+                case '/':  dst += '/'; break;
+                case 'u':
+                    {
+                        // only ASCII can be displayed
+                        const auto hex = src.substr(i + 1, 4);
+                        int code = 0;
+                        for (auto ch : hex) {
+                            code = 16*code + (ch >= 'a' ? ch - 'a' + 10 : ch >= 'A' ? ch - 'A' + 10 : ch - '0');
+                        }
+                        const char ch = code > 0 && code < 128 ? code : 1;
+                        appendSanitized(dst, { &ch, 1 });
+                        i += hex.size();
+                    }
+                    break;
+                default:
+                    dst += '@';
+            }
+        }
+    }
+
+    static int32_t parseInt(std::string_view s) {
+        int32_t res = 0;
+        for (auto ch : s) {
+            if (ch < '0' || ch > '9') break;
+            res = 10*res + (ch - '0');
+        }
+        return res;
+    }
+
+    const char * data = nullptr;
+    size_t size = 0;
+
+#ifdef SLACK_LOG_LOADER_MMAP
+    int fd = -1;
+#else
+    std::string buffer;
+#endif
+
+    std::atomic<bool> stop = false;
+    std::thread worker;
+
+    mutable std::mutex mutex;
+    bool isDone = true;
+    std::deque<LogBatch> pending;
+};
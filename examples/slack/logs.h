@@ -1,14 +1,12 @@
 #pragma once
 
-#include <string>
-#include <vector>
-
+// plain character arrays, so that the table is constant-initialized instead of building strings at startup
 struct Log {
-    std::string username;
-    std::string text;
+    const char * username;
+    const char * text;
 };
 
-const std::vector<Log> kLogs = {
+const Log kLogs[] = {
     { "dirbaio[m]"      , R"foo(oh lol and the proxy forwards the logs)foo" },
     { "jschievink"      , R"foo(yeah, that part works surprisingly well)foo" },
     { "dirbaio[m]"      , R"foo(🤯)foo" },
@@ -1,6 +1,12 @@
 #include "imtui/imtui.h"
 
+#include "time-format.h"
+
 #include "logs.h"
+#include "firehose.h"
+#include "log-loader.h"
+#include "message-store.h"
+#include "search-index.h"
 
 #ifdef __EMSCRIPTEN__
 
@@ -19,8 +25,13 @@
 
 #endif
 
+#include <bit>
+#include <cfloat>
+#include <chrono>
 #include <cstdio>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 ImVec4 toVec4(int r, int g, int b) {
@@ -31,24 +42,6 @@ ImVec4 toVec4(int r, int g, int b, int a) {
     return ImVec4(r/255.0f, g/255.0f, b/255.0f, a/255.0f);
 }
 
-// convert seconds to [Friday, July 22]
-std::string tToDate(int32_t t_s) {
-    char buf[256];
-    time_t t = t_s;
-    struct tm *tm = localtime(&t);
-    strftime(buf, sizeof(buf), "%A, %B %d", tm);
-    return buf;
-}
-
-// convert seconds to [hh:mm]
-std::string tToTime(int32_t t_s) {
-    char buf[256];
-    time_t t = t_s;
-    struct tm *tm = localtime(&t);
-    strftime(buf, sizeof(buf), "%H:%M", tm);
-    return buf;
-}
-
 // get current timestamp in seconds
 int32_t tGet() {
     return time(nullptr);
@@ -102,52 +95,123 @@ struct ColorTheme {
     ImVec4 indicatorOffline = toVec4(190, 190, 190);
 };
 
-struct Message {
-    int32_t t_s; // timestamp in seconds
-    int32_t uid; // userId
+// set of dense ids (user ids, channel indices) stored as a bitset
+struct IdSet {
+    std::vector<uint64_t> bits;
+    int n = 0;
 
-    std::string text;
+    inline int count() const { return n; }
+
+    inline bool contains(int32_t id) const {
+        const size_t w = id >> 6;
+        return w < bits.size() && ((bits[w] >> (id & 63)) & 1);
+    }
+
+    inline void insert(int32_t id) {
+        const size_t w = id >> 6;
+        if (w >= bits.size()) {
+            bits.resize(w + 1, 0);
+        }
+        if (contains(id) == false) {
+            bits[w] |= uint64_t(1) << (id & 63);
+            ++n;
+        }
+    }
+
+    inline void erase(int32_t id) {
+        if (contains(id)) {
+            bits[id >> 6] &= ~(uint64_t(1) << (id & 63));
+            --n;
+        }
+    }
 
-    int32_t reactUp;
-    int32_t reactDown;
+    // call f(id) for each id in the set in increasing order
+    template <typename F>
+    inline void forEach(F && f) const {
+        for (size_t w = 0; w < bits.size(); ++w) {
+            for (uint64_t cur = bits[w]; cur; cur &= cur - 1) {
+                f((int32_t) (64*w + std::countr_zero(cur)));
+            }
+        }
+    }
+};
+
+// read marker of a conversation and the counters that depend on it
+// the counters are maintained when messages are appended and when the marker moves - they are never recomputed from
+// the whole conversation
+struct ReadState {
+    int32_t marker    = 0; // top-level messages before this row have been read
+    int32_t nUnread   = 0;
+    int32_t nMentions = 0; // unread messages that mention the local user
+
+    uint32_t epoch = 1; // changes whenever the sidebar entry of the conversation has to change
+
+    inline void onAppend(bool isMention) {
+        if (nUnread == 0 || isMention) {
+            ++epoch;
+        }
+        ++nUnread;
+        nMentions += isMention;
+    }
+
+    inline void markRead(int32_t nMessages) {
+        marker = nMessages;
+        if (nUnread > 0 || nMentions > 0) {
+            ++epoch;
+        }
+        nUnread = 0;
+        nMentions = 0;
+    }
 };
 
-struct MessageWithReplies {
-    Message msg;
+// cached sidebar strings - rebuilt only when the ReadState epoch changes
+struct SidebarLabel {
+    uint32_t epoch = 0;
 
-    std::vector<MessageWithReplies> replies;
+    std::string text;
+    char badge[16];
 };
 
 struct User {
     int32_t id;
 
     bool isOnline;
-    bool hasUnread;
 
     std::string username;
     std::string bio;
 
-    std::vector<MessageWithReplies> messages;
-};
+    IdSet channels; // indices of the channels that the user is a member of
 
-struct Channel {
-    bool hasUnread;
+    MessageStore messages;
+
+    ReadState read = {};
+    mutable SidebarLabel sidebar = {};
 
-    int32_t mentions;
+    // append a DM and update the read state
+    int post(int32_t t_s, int32_t uid, std::string_view body) {
+        read.onAppend(false);
+        return messages.add(t_s, uid, body);
+    }
+};
 
+struct Channel {
     std::string label;
     std::string description;
 
-    std::vector<User> members;
-    std::vector<MessageWithReplies> messages;
+    IdSet members; // user ids - the user data lives in UI::users
+    MessageStore messages;
+
+    ReadState read = {};
+    mutable SidebarLabel sidebar = {};
+
+    // append a message and update the read state
+    int post(int32_t t_s, int32_t uid, std::string_view body, bool isMention) {
+        read.onAppend(isMention);
+        return messages.add(t_s, uid, body);
+    }
 
     bool isMember(int32_t uid) const {
-        for (auto &member : members) {
-            if (member.id == uid) {
-                return true;
-            }
-        }
-        return false;
+        return members.contains(uid);
     }
 };
 
@@ -179,9 +243,13 @@ struct UI {
     bool showApps           = true;
     bool showStyleEditor    = false;
     bool showThreadPanel    = false;
+    bool showSearch         = false;
+    bool showFirehose       = false;
 
     bool doScrollMain   = false;
 
+    int scrollToMessage = -1; // top-level message row to bring into view in the main window
+
     std::vector<Channel> channels;
     int selectedChannel = -1;
 
@@ -191,8 +259,32 @@ struct UI {
     int threadChannel = -1;
     int threadMessage = -1;
 
+    char searchQuery[128] = "";
+
     ColorTheme colors;
 
+    TimeFormat timeFormat;
+
+    std::string mentionTag; // "@username" of the local user
+
+    bool isMention(std::string_view body) const {
+        return body.find(mentionTag) != std::string_view::npos;
+    }
+
+    // move the read marker of a conversation back to "row" - only the messages after it are counted
+    template <typename T>
+    void markUnread(T & conv, int row) {
+        const auto & store = conv.messages;
+
+        conv.read.marker = row;
+        conv.read.nUnread = store.size() - row;
+        conv.read.nMentions = 0;
+        for (int i = row; i < store.size(); ++i) {
+            conv.read.nMentions += isMention(store.getTextView(store.messages, i));
+        }
+        ++conv.read.epoch;
+    }
+
     void setStyle(EStyle style);
 
     void renderSeparator(const char * prefix, const char * ch, const char * suffix, int n, bool disabled);
@@ -206,7 +298,8 @@ struct UI {
 
     void renderOnlineIndicator(const char * symbol, bool online);
 
-    bool renderMessages(const std::vector<MessageWithReplies> & messages, int width, bool isThread);
+    // render rows [begin, end) - "rows" is either store.messages or store.replies
+    bool renderMessages(MessageStore & store, MessageColumns & rows, int begin, int end, int width, bool isThread);
 };
 
 void UI::setStyle(EStyle styleId) {
@@ -341,6 +434,15 @@ bool UI::renderChannel(const Channel & channel, int width, bool selected) {
     int npop = 0;
     bool result = false;
 
+    const auto & read = channel.read;
+    auto & label = channel.sidebar;
+
+    if (label.epoch != read.epoch) {
+        label.epoch = read.epoch;
+        label.text = "# " + channel.label;
+        snprintf(label.badge, sizeof(label.badge), " %d ", read.nMentions);
+    }
+
     ImGui::PushID(channel.label.c_str());
     const auto p0 = ImGui::GetCursorScreenPos();
     if (selected) {
@@ -350,23 +452,21 @@ bool UI::renderChannel(const Channel & channel, int width, bool selected) {
     if (ImGui::Button("##but", ImVec2(width, 1))) {
         result = true;
     }
-    if (channel.mentions > 0) {
+    if (read.nMentions > 0) {
         ImGui::SetCursorScreenPos({ p0.x + width - 6, p0.y });
         ImGui::PushStyleColor(ImGuiCol_Text,          colors.channelMentionsFG);
         ImGui::PushStyleColor(ImGuiCol_Button,        colors.channelMentionsBG);
         ImGui::PushStyleColor(ImGuiCol_ButtonHovered, colors.channelMentionsBG);
         ImGui::PushStyleColor(ImGuiCol_ButtonActive,  colors.channelMentionsBG);
-        static char buf[16];
-        sprintf(buf, " %d ", channel.mentions);
-        ImGui::SmallButton(buf);
+        ImGui::SmallButton(label.badge);
         ImGui::PopStyleColor(4);
     }
-    if (ImGui::IsItemHovered() || selected || channel.hasUnread || channel.mentions > 0) {
+    if (ImGui::IsItemHovered() || selected || read.nUnread > 0) {
         ImGui::PushStyleColor(ImGuiCol_Text, colors.channelActiveFG);
         ++npop;
     }
     ImGui::SetCursorScreenPos(p0);
-    ImGui::Text("# %s", channel.label.c_str());
+    ImGui::Text("%s", label.text.c_str());
     ImGui::PopStyleColor(npop);
     ImGui::PopID();
 
@@ -382,7 +482,7 @@ bool UI::renderUser(const User & user, int width, bool selected) {
     if (ImGui::Button("##but", ImVec2(width, 1))) {
         result = true;
     }
-    if (ImGui::IsItemHovered() || selected || user.hasUnread) {
+    if (ImGui::IsItemHovered() || selected || user.read.nUnread > 0) {
         ImGui::PushStyleColor(ImGuiCol_Text, colors.userActiveFG);
         ++npop;
     }
@@ -404,32 +504,36 @@ void UI::renderOnlineIndicator(const char * symbol, bool online) {
     }
 }
 
-bool UI::renderMessages(const std::vector<MessageWithReplies> & messages, int width, bool isThread) {
+bool UI::renderMessages(MessageStore & store, MessageColumns & rows, int begin, int end, int width, bool isThread) {
     int32_t lastUid = -1;
-    std::string lastDate = "";
+    int32_t lastDay = -1;
 
     ImGui::PushTextWrapPos(width - 4);
 
-    for (int i = 0; i < (int) messages.size(); i++) {
-        const auto & message = messages[i];
-        const auto & uid = message.msg.uid;
+    for (int i = begin; i < end; i++) {
+        const auto t_s       = rows.t_s[i];
+        const auto uid       = rows.uid[i];
+        const auto reactUp   = rows.reactUp[i];
+        const auto reactDown = rows.reactDown[i];
+        const auto text      = store.getText(rows, i);
+        const auto nReplies  = isThread ? 0 : store.nReplies(i);
         const auto & user = users[uid];
 
         ImGui::PushID(i);
 
         // render new date separator
         {
-            const auto curDate = tToDate(message.msg.t_s);
-            if (curDate != lastDate) {
-                const auto l = curDate.size() + 6;
+            const auto & curDay = timeFormat.day(t_s);
+            if (curDay.id != lastDay) {
+                const auto l = strlen(curDay.date) + 6;
 
                 ImGui::Text("%s", "");
                 renderSeparator("", "-", "", width/2 - l/2 - 1, true);
                 ImGui::SameLine();
-                ImGui::Text("%s", curDate.c_str());
+                ImGui::Text("%s", curDay.date);
                 ImGui::SameLine();
                 renderSeparator("", "-", "", width/2 - l/2 - 1, true);
-                lastDate = curDate;
+                lastDay = curDay.id;
             }
         }
 
@@ -439,35 +543,40 @@ bool UI::renderMessages(const std::vector<MessageWithReplies> & messages, int wi
             ImGui::Text("%s", "");
             ImGui::TextColored(colors.messageUser, "%s", user.username.c_str());
             ImGui::SameLine();
-            ImGui::TextColored(colors.messageTime, "%s", tToTime(message.msg.t_s).c_str());
+            ImGui::TextColored(colors.messageTime, "%s", timeFormat.time(t_s));
         }
-        ImGui::Text("%s", message.msg.text.c_str());
-        if (message.msg.reactUp > 0) {
+        ImGui::Text("%s", text);
+        if (reactUp > 0) {
             ImGui::TextColored(colors.messageReact, "%s", "[+]");
             ImGui::SameLine();
-            ImGui::Text("%d", message.msg.reactUp);
+            ImGui::Text("%d", reactUp);
         }
 
-        if (message.msg.reactDown > 0) {
-            if (message.msg.reactUp > 0) {
+        if (reactDown > 0) {
+            if (reactUp > 0) {
                 ImGui::SameLine();
             }
             ImGui::TextColored(colors.messageReact, "%s", "[-]");
             ImGui::SameLine();
-            ImGui::Text("%d", message.msg.reactDown);
+            ImGui::Text("%d", reactDown);
         }
 
-        if (message.replies.size() > 0) {
-            if (message.msg.reactUp > 0 || message.msg.reactDown > 0) {
+        if (nReplies > 0) {
+            if (reactUp > 0 || reactDown > 0) {
                 ImGui::SameLine();
                 ImGui::Text("|");
                 ImGui::SameLine();
             }
-            ImGui::TextColored(colors.messageReplies, "%d replies", (int) message.replies.size());
+            ImGui::TextColored(colors.messageReplies, "%d replies", nReplies);
         }
 
         const auto p1 = ImVec2 { ImGui::GetCursorScreenPos().x + width, ImGui::GetCursorScreenPos().y };
 
+        if (!isThread && i == scrollToMessage) {
+            ImGui::SetScrollHereY(0.5f);
+            scrollToMessage = -1;
+        }
+
         bool doUpvote = false;
         bool doReplyInThead = false;
 
@@ -482,10 +591,10 @@ bool UI::renderMessages(const std::vector<MessageWithReplies> & messages, int wi
                 ImGui::Text("%s", "");
                 ImGui::TextColored(colors.messageUser, "%s", user.username.c_str());
                 ImGui::SameLine();
-                ImGui::TextColored(colors.messageTime, "%s", tToTime(message.msg.t_s).c_str());
+                ImGui::TextColored(colors.messageTime, "%s", timeFormat.time(t_s));
             }
-            ImGui::Text("%s", message.msg.text.c_str());
-            if (message.msg.reactUp > 0) {
+            ImGui::Text("%s", text);
+            if (reactUp > 0) {
                 ImGui::TextColored(colors.messageReact, "%s", "[+]");
                 if (ImGui::IsItemHovered()) {
                     ImGui::SetNextWindowPos({ ImGui::GetIO().MousePos.x - 10, p0.y - 4 });
@@ -495,10 +604,10 @@ bool UI::renderMessages(const std::vector<MessageWithReplies> & messages, int wi
                     ImGui::TextColored(colors.messageReact, "%s", "[+]");
                     ImGui::Text("%s", "");
                     int w = 0;
-                    for (int i = 0; i < message.msg.reactUp; i++) {
+                    for (int i = 0; i < reactUp; i++) {
                         const auto & username = users[i%users.size()].username;
                         ImGui::TextColored(colors.messageUser, "%s%s", username.c_str(),
-                                           i == message.msg.reactUp - 1 ? "" : i == message.msg.reactUp - 2 ? " and" : ",");
+                                           i == reactUp - 1 ? "" : i == reactUp - 2 ? " and" : ",");
                         if (w += username.size(); w < 20) {
                             ImGui::SameLine();
                         } else {
@@ -510,11 +619,11 @@ bool UI::renderMessages(const std::vector<MessageWithReplies> & messages, int wi
                     ImGui::EndTooltip();
                 }
                 ImGui::SameLine();
-                ImGui::Text("%d", message.msg.reactUp);
+                ImGui::Text("%d", reactUp);
             }
 
-            if (message.msg.reactDown > 0) {
-                if (message.msg.reactUp > 0) {
+            if (reactDown > 0) {
+                if (reactUp > 0) {
                     ImGui::SameLine();
                 }
                 ImGui::TextColored(colors.messageReact, "%s", "[-]");
@@ -526,10 +635,10 @@ bool UI::renderMessages(const std::vector<MessageWithReplies> & messages, int wi
                     ImGui::TextColored(colors.messageReact, "%s", "[-]");
                     ImGui::Text("%s", "");
                     int w = 0;
-                    for (int i = 0; i < message.msg.reactDown; i++) {
+                    for (int i = 0; i < reactDown; i++) {
                         const auto & username = users[i%users.size()].username;
                         ImGui::TextColored(colors.messageUser, "%s%s", username.c_str(),
-                                             i == message.msg.reactDown - 1 ? "" : i == message.msg.reactDown - 2 ? " and" : ",");
+                                             i == reactDown - 1 ? "" : i == reactDown - 2 ? " and" : ",");
                         if (w += username.size(); w < 20) {
                             ImGui::SameLine();
                         } else {
@@ -541,16 +650,16 @@ bool UI::renderMessages(const std::vector<MessageWithReplies> & messages, int wi
                     ImGui::EndTooltip();
                 }
                 ImGui::SameLine();
-                ImGui::Text("%d", message.msg.reactDown);
+                ImGui::Text("%d", reactDown);
             }
 
-            if (message.replies.size() > 0) {
-                if (message.msg.reactUp > 0 || message.msg.reactDown > 0) {
+            if (nReplies > 0) {
+                if (reactUp > 0 || reactDown > 0) {
                     ImGui::SameLine();
                     ImGui::Text("|");
                     ImGui::SameLine();
                 }
-                ImGui::TextColored(colors.messageReplies, "%d replies", (int) message.replies.size());
+                ImGui::TextColored(colors.messageReplies, "%d replies", nReplies);
                 if (ImGui::IsItemHovered()) {
                     ImGui::SameLine();
                     ImGui::SmallButton("View thread");
@@ -591,7 +700,7 @@ bool UI::renderMessages(const std::vector<MessageWithReplies> & messages, int wi
 
         if (doUpvote) {
             if (!isThread) {
-                channels[selectedChannel].messages[i].msg.reactUp++;
+                rows.reactUp[i]++;
             }
         }
 
@@ -615,16 +724,181 @@ UI g_ui;
 bool g_isRunning = true;
 ImTui::TScreen * g_screen = nullptr;
 
+LogLoader g_logLoader;
+
+MessageStore g_logs; // the sample logs, sanitized
+
+Firehose g_firehose;
+Histogram g_frameTime(50, 1.0f); // processing and rendering, without the wait for the next frame
+Histogram g_latency(50, 4.0f); // from the arrival of a message to the end of the rendering of the frame that shows it
+Histogram g_queryTime(50, 0.2f);
+
+std::vector<int64_t> g_arrivals; // arrival times of the messages added in the current frame
+
+// append the messages from the load generator to the channels
+void drainFirehose() {
+    static std::string text;
+
+    const auto & me = g_ui.users[0];
+
+    FirehoseMessage msg;
+    while (g_firehose.pop(msg)) {
+        auto & channel = g_ui.channels[msg.channel];
+
+        std::string_view body = g_logs.getTextView(g_logs.messages, msg.logId);
+        if (msg.isMention) {
+            text = "@" + me.username + " ";
+            text += body;
+            body = text;
+        }
+
+        channel.post(tGet(), msg.uid, body, msg.isMention);
+
+        g_arrivals.push_back(msg.tArrival_us);
+    }
+}
+
+SearchIndex g_searchIndex;
+std::vector<SearchCursor> g_searchCursors; // channels first, then DMs
+std::vector<SearchDoc> g_searchResults;
+
+const MessageStore & getConversation(int32_t conv) {
+    const int nChannels = g_ui.channels.size();
+    return conv < nChannels ? g_ui.channels[conv].messages : g_ui.users[conv - nChannels].messages;
+}
+
+// queue the messages that were added since the last frame for indexing
+void updateSearchIndex() {
+    const int nChannels = g_ui.channels.size();
+    const int nUsers    = g_ui.users.size();
+
+    g_searchCursors.resize(nChannels + nUsers);
+
+    for (int i = 0; i < nChannels; ++i) {
+        g_searchIndex.add(i, g_ui.channels[i].messages, g_searchCursors[i]);
+    }
+
+    for (int i = 0; i < nUsers; ++i) {
+        g_searchIndex.add(nChannels + i, g_ui.users[i].messages, g_searchCursors[nChannels + i]);
+    }
+
+#ifdef __EMSCRIPTEN__
+    // no worker thread
+    g_searchIndex.update(4.0f);
+#endif
+}
+
+// append the chat lines parsed by the log loader to the channels
+// returns true if anything was added - stops after budget_ms, the rest is picked up on the next frame
+bool ingestLogs(float budget_ms) {
+    static LogBatch batch;
+    static int nextRecord = 0;
+
+    static std::unordered_map<std::string_view, int32_t> uids;
+    static std::unordered_map<std::string_view, int> channelIds;
+
+    if (channelIds.empty()) {
+        for (int i = 0; i < (int) g_ui.channels.size(); ++i) {
+            channelIds[g_ui.channels[i].label] = i;
+        }
+    }
+
+    const auto tStart = std::chrono::steady_clock::now();
+
+    bool updated = false;
+
+    while (true) {
+        if (nextRecord == (int) batch.records.size()) {
+            nextRecord = 0;
+            if (g_logLoader.poll(batch) == false) {
+                batch = {};
+                break;
+            }
+        }
+
+        const auto & record = batch.records[nextRecord++];
+
+        // unknown channels and users are spread over the existing ones
+        int channelId = 0;
+        if (auto it = channelIds.find(record.channel); it != channelIds.end()) {
+            channelId = it->second;
+        } else {
+            channelId = std::hash<std::string_view>()(record.channel) % g_ui.channels.size();
+        }
+
+        int32_t uid = 0;
+        if (auto it = uids.find(record.username); it != uids.end()) {
+            uid = it->second;
+        } else {
+            uid = std::hash<std::string_view>()(record.username) % g_ui.users.size();
+            uids[record.username] = uid;
+        }
+
+        auto & channel = g_ui.channels[channelId];
+        const auto & store = channel.messages;
+
+        int32_t t = record.t_s;
+        if (t == 0) {
+            t = store.size() > 0 ? store.messages.t_s.back() + rand()%60 : tGet() - 24*3600*30;
+        }
+
+        const auto text = batch.getText(record);
+        channel.post(t, uid, text, g_ui.isMention(text));
+        updated = true;
+
+        if ((nextRecord & 255) == 0) {
+            const auto tNow = std::chrono::steady_clock::now();
+            if (std::chrono::duration<float, std::milli>(tNow - tStart).count() > budget_ms) {
+                break;
+            }
+        }
+    }
+
+    return updated;
+}
+
 extern "C" {
 
     EMSCRIPTEN_KEEPALIVE
         bool render_frame() {
 #ifdef __EMSCRIPTEN__
             ImTui_ImplEmscripten_NewFrame();
+
+            if (g_firehose.isRunning) {
+                g_firehose.produce(Firehose::t_us());
+            }
+
+            bool isActive = false;
+            isActive |= g_searchIndex.nPending() > 0;
+            isActive |= g_firehose.isRunning;
 #else
             bool isActive = false;
             isActive |= ImTui_ImplNcurses_NewFrame();
+            isActive |= g_logLoader.isLoading();
+            isActive |= g_searchIndex.nPending() > 0;
+            isActive |= g_firehose.isRunning;
 #endif
+
+            const auto tFrameStart_us = Firehose::t_us();
+
+            drainFirehose();
+
+            g_ui.timeFormat.update(tGet());
+
+            // the selected conversation is being read
+            if (g_ui.selectedChannel >= 0) {
+                auto & channel = g_ui.channels[g_ui.selectedChannel];
+                channel.read.markRead(channel.messages.size());
+            }
+
+            if (g_ui.selectedUser >= 0) {
+                auto & user = g_ui.users[g_ui.selectedUser];
+                user.read.markRead(user.messages.size());
+            }
+
+            ingestLogs(8.0f);
+            updateSearchIndex();
+
             ImTui_ImplText_NewFrame();
 
             ImGui::NewFrame();
@@ -718,6 +992,12 @@ extern "C" {
 
                     ImGui::MenuItem("Hide Sidebar", "Shift+Cmd+D");
 
+                    ImGui::TextDisabled("--------------");
+
+                    if (ImGui::MenuItem("Firehose", nullptr, g_ui.showFirehose)) {
+                        g_ui.showFirehose = !g_ui.showFirehose;
+                    }
+
                     ImGui::TextDisabled("%s", "");
                     ImGui::EndMenu();
                 }
@@ -920,6 +1200,9 @@ extern "C" {
                 g_ui.renderSeparator("-", "-", "-", g_ui.leftPanelW - 4, true);
                 ImGui::Text("%s", "");
 
+                if (g_ui.renderButton("? Search",             g_ui.leftPanelW, g_ui.showSearch)) {
+                    g_ui.showSearch = !g_ui.showSearch;
+                }
                 g_ui.renderButton("\\ Threads",             g_ui.leftPanelW, false);
                 g_ui.renderButton("& Direct Messages",      g_ui.leftPanelW, false);
                 g_ui.renderButton("@ Mentions & reactions", g_ui.leftPanelW, false);
@@ -1047,8 +1330,107 @@ extern "C" {
 
                 ImGui::Text("%s", "");
 
-                if (g_ui.selectedChannel >= 0) {
-                    const auto & channel = g_ui.channels[g_ui.selectedChannel];
+                if (g_ui.showSearch) {
+                    {
+                        ImGui::PushStyleColor(ImGuiCol_Text,   g_ui.colors.mainWindowTitleFG);
+                        ImGui::PushStyleColor(ImGuiCol_Button, g_ui.colors.mainWindowBG);
+                        const auto p0 = ImGui::GetCursorScreenPos();
+                        ImGui::Text("%s", "");
+                        ImGui::Text("? Search");
+                        ImGui::SameLine();
+                        ImGui::PushStyleColor(ImGuiCol_FrameBg, g_ui.colors.inputBG);
+                        ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0, 0));
+                        ImGui::PushItemWidth(g_ui.mainWindowW - 18);
+                        if (ImGui::IsWindowAppearing()) {
+                            ImGui::SetKeyboardFocusHere();
+                        }
+                        ImGui::InputText("##search", g_ui.searchQuery, sizeof(g_ui.searchQuery));
+                        ImGui::PopItemWidth();
+                        ImGui::PopStyleVar();
+                        ImGui::PopStyleColor();
+                        ImGui::SetCursorScreenPos({ p0.x + g_ui.mainWindowW - 7, p0.y + 1 });
+                        if (ImGui::Button("|x|")) {
+                            g_ui.showSearch = false;
+                        }
+                        ImGui::PopStyleColor(2);
+                    }
+
+                    // run the query when it changes or when new messages have been indexed
+                    static std::string lastQuery;
+                    static int lastDocs = -1;
+                    static float lastQuery_ms = 0.0f;
+                    static bool lastComplete = true;
+
+                    const int nDocs = g_searchIndex.nDocs();
+                    if (lastQuery != g_ui.searchQuery || lastDocs != nDocs) {
+                        const auto tStart = std::chrono::steady_clock::now();
+                        lastComplete = g_searchIndex.query(g_ui.searchQuery, g_searchResults, [](const SearchDoc & doc) {
+                            const auto & store = getConversation(doc.conv);
+                            return std::string_view(store.text.data() + doc.textBegin, doc.textSize);
+                        });
+                        const auto tEnd = std::chrono::steady_clock::now();
+
+                        lastQuery = g_ui.searchQuery;
+                        lastDocs = nDocs;
+                        lastQuery_ms = std::chrono::duration<float, std::milli>(tEnd - tStart).count();
+                        g_queryTime.add(lastQuery_ms);
+                    }
+
+                    ImGui::TextDisabled(" %d%s results (%.2f ms) | %d messages indexed, %d pending",
+                                        (int) g_searchResults.size(), lastComplete ? "" : "+",
+                                        lastQuery_ms, nDocs, g_searchIndex.nPending());
+                    g_ui.renderSeparator("-", "-", "-", g_ui.mainWindowW - 4, true);
+
+                    ImGui::BeginChild("search results", ImVec2(g_ui.mainWindowW - 2, g_ui.messagesWindowH), true);
+
+                    const int nChannels = g_ui.channels.size();
+
+                    // only the visible rows are rendered
+                    ImGuiListClipper clipper;
+                    clipper.Begin(g_searchResults.size(), 1.0f);
+                    while (clipper.Step()) {
+                        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                            const auto & doc = g_searchResults[i];
+                            const auto & store = getConversation(doc.conv);
+
+                            ImGui::PushID(i);
+                            const auto p0 = ImGui::GetCursorScreenPos();
+                            if (ImGui::Selectable("##result", false, 0, ImVec2(g_ui.mainWindowW - 4, 1))) {
+                                g_ui.showSearch = false;
+                                if (doc.conv < nChannels) {
+                                    g_ui.selectedChannel = doc.conv;
+                                    g_ui.selectedUser    = -1;
+                                    if (doc.isReply) {
+                                        g_ui.showThreadPanel = true;
+                                        g_ui.threadChannel   = doc.conv;
+                                        g_ui.threadMessage   = doc.msg;
+                                    }
+                                } else {
+                                    g_ui.selectedChannel = -1;
+                                    g_ui.selectedUser    = doc.conv - nChannels;
+                                }
+                                g_ui.scrollToMessage = doc.msg;
+                            }
+                            ImGui::SetCursorScreenPos(p0);
+                            if (doc.conv < nChannels) {
+                                ImGui::TextDisabled("# %-12.12s", g_ui.channels[doc.conv].label.c_str());
+                            } else {
+                                ImGui::TextDisabled("@ %-12.12s", g_ui.users[doc.conv - nChannels].username.c_str());
+                            }
+                            ImGui::SameLine();
+                            ImGui::TextColored(g_ui.colors.messageUser, "%-16.16s", g_ui.users[doc.uid].username.c_str());
+                            ImGui::SameLine();
+                            ImGui::Text("%s%.*s", doc.isReply ? "> " : "", std::max(0, g_ui.mainWindowW - 40), store.text.data() + doc.textBegin);
+                            ImGui::PopID();
+                        }
+                    }
+                    clipper.End();
+
+                    ImGui::EndChild();
+                }
+
+                if (g_ui.showSearch == false && g_ui.selectedChannel >= 0) {
+                    auto & channel = g_ui.channels[g_ui.selectedChannel];
 
                     {
 
@@ -1066,7 +1448,7 @@ extern "C" {
                         ImGui::SetCursorScreenPos({ p0.x + g_ui.mainWindowW - 7, p0.y + 1 });
                         {
                             static char buf[16];
-                            sprintf(buf, "[%2d]", (int) channel.members.size());
+                            sprintf(buf, "[%2d]", channel.members.count());
                             if (ImGui::Button(buf)) {
                                 ImGui::OpenPopup("Channel Info");
                             }
@@ -1079,7 +1461,7 @@ extern "C" {
 
                     ImGui::BeginChild("messages", ImVec2(g_ui.mainWindowW - 2, g_ui.messagesWindowH), true);
 
-                    g_ui.renderMessages(channel.messages, g_ui.mainWindowW, false);
+                    g_ui.renderMessages(channel.messages, channel.messages.messages, 0, channel.messages.size(), g_ui.mainWindowW, false);
 
                     if (g_ui.doScrollMain) {
                         ImGui::SetScrollHereY(1.0f);
@@ -1135,17 +1517,15 @@ extern "C" {
 
                             {
                                 static char buf[16];
-                                snprintf(buf, sizeof(buf), "Members %d", (int) channel.members.size());
+                                snprintf(buf, sizeof(buf), "Members %d", channel.members.count());
                                 ImGui::PushStyleColor(ImGuiCol_Text, g_ui.colors.mainWindowTitleFG);
                                 if (ImGui::BeginTabItem(buf)) {
                                     ImGui::PopStyleColor();
                                     ImGui::Text("%s", "");
 
-                                    const auto & users = channel.members;
-                                    for (int i = 0; i < (int) users.size(); ++i) {
-                                        const auto & user = users[i];
-                                        g_ui.renderUser(user, g_ui.infoWindowW, false);
-                                    }
+                                    channel.members.forEach([](int32_t uid) {
+                                        g_ui.renderUser(g_ui.users[uid], g_ui.infoWindowW, false);
+                                    });
 
                                     ImGui::Text("%s", "");
                                     ImGui::EndTabItem();
@@ -1187,8 +1567,8 @@ extern "C" {
                     }
                 }
 
-                if (g_ui.selectedUser >= 0) {
-                    const auto & user = g_ui.users[g_ui.selectedUser];
+                if (g_ui.showSearch == false && g_ui.selectedUser >= 0) {
+                    auto & user = g_ui.users[g_ui.selectedUser];
 
                     {
                         ImGui::PushStyleColor(ImGuiCol_Text,   g_ui.colors.mainWindowTitleFG);
@@ -1210,7 +1590,7 @@ extern "C" {
 
                     ImGui::BeginChild("messages", ImVec2(g_ui.mainWindowW - 1, g_ui.messagesWindowH), true);
 
-                    g_ui.renderMessages(user.messages, g_ui.mainWindowW, false);
+                    g_ui.renderMessages(user.messages, user.messages.messages, 0, user.messages.size(), g_ui.mainWindowW, false);
 
                     if (g_ui.doScrollMain) {
                         ImGui::SetScrollHereY(1.0f);
@@ -1331,10 +1711,10 @@ extern "C" {
 
                     if (doSend) {
                         if (g_ui.selectedChannel > 0) {
-                            g_ui.channels[g_ui.selectedChannel].messages.push_back({ { tGet(), 0, input, 0, 0, }, {} });
+                            g_ui.channels[g_ui.selectedChannel].post(tGet(), 0, input, false);
                         }
                         if (g_ui.selectedUser > 0) {
-                            g_ui.users[g_ui.selectedUser].messages.push_back({ { tGet(), 0, input, 0, 0, }, {} });
+                            g_ui.users[g_ui.selectedUser].post(tGet(), 0, input);
                         }
                         g_ui.doScrollMain = true;
                         memset(input, 0, sizeof(input));
@@ -1383,7 +1763,8 @@ extern "C" {
                 ImGui::Text("%s", "");
 
                 if (g_ui.threadChannel >= 0) {
-                    const auto & channel = g_ui.channels[g_ui.threadChannel];
+                    auto & channel = g_ui.channels[g_ui.threadChannel];
+                    auto & store = channel.messages;
 
                     {
                         ImGui::PushStyleColor(ImGuiCol_Text,   g_ui.colors.mainWindowTitleFG);
@@ -1407,9 +1788,9 @@ extern "C" {
 
                     ImGui::BeginChild("messages", ImVec2(g_ui.threadPanelW - 1, g_ui.threadPanelH - 6), true);
 
-                    g_ui.renderMessages({{ channel.messages[g_ui.threadMessage].msg, {} }}, g_ui.threadPanelW, true);
+                    g_ui.renderMessages(store, store.messages, g_ui.threadMessage, g_ui.threadMessage + 1, g_ui.threadPanelW, true);
 
-                    if (int nreplies = channel.messages[g_ui.threadMessage].replies.size(); nreplies > 0) {
+                    if (int nreplies = store.nReplies(g_ui.threadMessage); nreplies > 0) {
                         ImGui::Text("%s", "");
                         {
                             static char buf[32];
@@ -1419,7 +1800,7 @@ extern "C" {
                         ImGui::Text("%s", "");
                     }
 
-                    g_ui.renderMessages(channel.messages[g_ui.threadMessage].replies, g_ui.threadPanelW, true);
+                    g_ui.renderMessages(store, store.replies, store.threadBegin[g_ui.threadMessage], store.threadEnd[g_ui.threadMessage], g_ui.threadPanelW, true);
 
                     // thread input
 
@@ -1530,7 +1911,7 @@ extern "C" {
                     }
 
                     if (doSend) {
-                        g_ui.channels[g_ui.threadChannel].messages[g_ui.threadMessage].replies.push_back({ { tGet(), 0, input, 0, 0, }, {} });
+                        store.addReply(g_ui.threadMessage, tGet(), 0, input);
                         memset(input, 0, sizeof(input));
                     }
 
@@ -1682,6 +2063,68 @@ extern "C" {
 
             }
 
+            if (g_ui.showFirehose) {
+                ImGui::SetNextWindowPos({ 20, 10 }, ImGuiCond_Once);
+                ImGui::SetNextWindowSize({ 60, 30 }, ImGuiCond_Once);
+                ImGui::Begin("Firehose", &g_ui.showFirehose);
+
+                ImGui::Text("%s", "");
+
+                {
+                    int rate = g_firehose.rate;
+                    if (ImGui::SliderInt("rate", &rate, 0, 50000, "%d msg/s")) {
+                        g_firehose.rate = rate;
+                    }
+
+                    int mentions = g_firehose.mentionsPerMille;
+                    if (ImGui::SliderInt("mentions", &mentions, 0, 1000, "%d per 1000")) {
+                        g_firehose.mentionsPerMille = mentions;
+                    }
+
+                    if (g_firehose.isRunning) {
+                        if (ImGui::Button("Stop")) {
+                            g_firehose.stop();
+                        }
+                    } else {
+                        if (ImGui::Button("Start")) {
+                            g_firehose.start(g_ui.channels.size(), g_ui.users.size(), g_logs.size());
+                        }
+                    }
+                    ImGui::SameLine();
+                    if (ImGui::Button("Reset stats")) {
+                        g_frameTime.reset();
+                        g_latency.reset();
+                        g_queryTime.reset();
+                    }
+                }
+
+                ImGui::Text("%s", "");
+                ImGui::Text("Produced: %d, dropped: %d, queued: %d",
+                            (int) g_firehose.nProduced, (int) g_firehose.nDropped, g_firehose.nQueued());
+                ImGui::Text("%s", "");
+
+                const float w = ImGui::GetContentRegionAvailWidth();
+
+                ImGui::Text("Frame time    p50 %5.1f ms  p99 %5.1f ms  max %5.1f ms",
+                            g_frameTime.percentile(0.5f), g_frameTime.percentile(0.99f), g_frameTime.max_ms);
+                ImGui::PlotHistogram("##frameTime", g_frameTime.counts.data(), g_frameTime.counts.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(w, 6));
+                ImGui::TextDisabled("0 ms %*s %g ms", (int) w - 16, "", g_frameTime.bucket_ms*g_frameTime.counts.size());
+
+                ImGui::Text("%s", "");
+                ImGui::Text("Latency       p50 %5.1f ms  p99 %5.1f ms  max %5.1f ms",
+                            g_latency.percentile(0.5f), g_latency.percentile(0.99f), g_latency.max_ms);
+                ImGui::PlotHistogram("##latency", g_latency.counts.data(), g_latency.counts.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(w, 6));
+                ImGui::TextDisabled("0 ms %*s %g ms", (int) w - 16, "", g_latency.bucket_ms*g_latency.counts.size());
+
+                ImGui::Text("%s", "");
+                ImGui::Text("Search        p50 %5.1f ms  p99 %5.1f ms  max %5.1f ms  (%d messages indexed)",
+                            g_queryTime.percentile(0.5f), g_queryTime.percentile(0.99f), g_queryTime.max_ms, g_searchIndex.nDocs());
+                ImGui::PlotHistogram("##queryTime", g_queryTime.counts.data(), g_queryTime.counts.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(w, 6));
+                ImGui::TextDisabled("0 ms %*s %g ms", (int) w - 16, "", g_queryTime.bucket_ms*g_queryTime.counts.size());
+
+                ImGui::End();
+            }
+
 #ifndef __EMSCRIPTEN__
             if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_Escape))) {
                 g_isRunning = false;
@@ -1692,7 +2135,20 @@ extern "C" {
 
             ImTui_ImplText_RenderDrawData(ImGui::GetDrawData(), g_screen);
 
-#ifndef __EMSCRIPTEN__
+            // measured before DrawScreen(), which waits for the next frame when there is time left
+            {
+                const auto tFrameEnd_us = Firehose::t_us();
+
+                g_frameTime.add(1e-3f*(tFrameEnd_us - tFrameStart_us));
+                for (auto tArrival_us : g_arrivals) {
+                    g_latency.add(1e-3f*(tFrameEnd_us - tArrival_us));
+                }
+                g_arrivals.clear();
+            }
+
+#ifdef __EMSCRIPTEN__
+            ImTui_ImplEmscripten_DrawScreen(isActive);
+#else
             ImTui_ImplNcurses_DrawScreen(isActive);
 #endif
 
@@ -1700,22 +2156,41 @@ extern "C" {
         }
 }
 
-int main() {
+int main(int argc, char ** argv) {
+    // optional chat log to load instead of the randomly generated channel messages
+    const char * fnameLogs = nullptr;
+
+    // start the load generator right away with the given rate (messages per second)
+    int firehoseRate = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--firehose") == 0 && i + 1 < argc) {
+            firehoseRate = atoi(argv[++i]);
+        } else {
+            fnameLogs = argv[i];
+        }
+    }
+
+    if (fnameLogs && g_logLoader.open(fnameLogs) == false) {
+        fprintf(stderr, "Failed to open chat log '%s'\n", fnameLogs);
+        return -1;
+    }
+
     // initialize some random workspace data
     {
         // channels
         {
             g_ui.channels = {
-                { false, 0, "compiler", "A channel about the compiler",       {}, {} },
-                { false, 0, "random",   "Random thoughts",                    {}, {} },
-                { false, 0, "general",  "The main channel about ImTui",       {}, {} },
-                { true,  0, "rust",     "Tell us how great this language is", {}, {} },
-                { false, 0, "c++",      "The best language",                  {}, {} },
-                { false, 2, "imtui",    "The best TUI library",               {}, {} },
-                { false, 0, "reddit",   "Dive into anything",                 {}, {} },
-                { false, 0, "hn",       "Hacker News",                        {}, {} },
-                { true,  0, "news",     "Mainstream media news",              {}, {} },
-                { false, 3, "builds",   "Build reports",                      {}, {} },
+                { "compiler", "A channel about the compiler",       {}, {} },
+                { "random",   "Random thoughts",                    {}, {} },
+                { "general",  "The main channel about ImTui",       {}, {} },
+                { "rust",     "Tell us how great this language is", {}, {} },
+                { "c++",      "The best language",                  {}, {} },
+                { "imtui",    "The best TUI library",               {}, {} },
+                { "reddit",   "Dive into anything",                 {}, {} },
+                { "hn",       "Hacker News",                        {}, {} },
+                { "news",     "Mainstream media news",              {}, {} },
+                { "builds",   "Build reports",                      {}, {} },
             };
 
             g_ui.selectedChannel = 2;
@@ -1724,17 +2199,17 @@ int main() {
         // users
         {
             g_ui.users = {
-                {  0, true , false, "Georgi Gerganov", "", {}},
-                {  1, false, false, "John Doe",        "", {}},
-                {  2, false, false, "Betty Basil",     "", {}},
-                {  3, true , true,  "Chace Jordana",   "", {}},
-                {  4, true , false, "Elon Musk",       "", {}},
-                {  5, false, false, "Vin Kennedi",     "", {}},
-                {  6, true , false, "Kilie Katlyn",    "", {}},
-                {  7, false, false, "Kaeden Gil",      "", {}},
-                {  8, false, false, "Mary Jane",       "", {}},
-                {  9, true , true,  "Adair Rigby",     "", {}},
-                { 10, true , false, "Bryce Bekki",     "", {}},
+                {  0, true , "Georgi Gerganov", "", {}, {}},
+                {  1, false, "John Doe",        "", {}, {}},
+                {  2, false, "Betty Basil",     "", {}, {}},
+                {  3, true , "Chace Jordana",   "", {}, {}},
+                {  4, true , "Elon Musk",       "", {}, {}},
+                {  5, false, "Vin Kennedi",     "", {}, {}},
+                {  6, true , "Kilie Katlyn",    "", {}, {}},
+                {  7, false, "Kaeden Gil",      "", {}, {}},
+                {  8, false, "Mary Jane",       "", {}, {}},
+                {  9, true ,  "Adair Rigby",     "", {}, {}},
+                { 10, true , "Bryce Bekki",     "", {}, {}},
             };
 
             g_ui.selectedUser = -1;
@@ -1748,42 +2223,44 @@ int main() {
                     while (g_ui.channels[channelIndex].isMember(user.id)) {
                         channelIndex = rand()%g_ui.channels.size();
                     }
-                    g_ui.channels[channelIndex].members.push_back(user);
+                    g_ui.channels[channelIndex].members.insert(user.id);
+                    user.channels.insert(channelIndex);
                 }
             }
         }
 
         // filter the logs, because we only support single-byte strings
-        std::vector<Log> logs;
-        for (auto & cur : kLogs) {
+        auto & logs = g_logs;
+        {
             std::string text;
-            for (auto & ch : cur.text) {
-                if (ch < 32) {
-                    text += "@";
-                } else if (ch == '<') {
-                    text += "@lt;";
-                } else if (ch == '>') {
-                    text += "@gt;";
-                } else if (ch == '&') {
-                    text += "@amp;";
-                } else {
-                    text += ch;
-                }
+            for (auto & cur : kLogs) {
+                text.clear();
+                appendSanitized(text, cur.text);
+                logs.add(0, 0, text);
             }
-
-            logs.push_back({ cur.username, std::move(text) });
         }
 
+        const auto logsSize = std::size(kLogs);
+        const auto logText = [&](int i) { return logs.getTextView(logs.messages, i); };
+        const auto logSameUser = [](int i0, int i1) { return strcmp(kLogs[i0].username, kLogs[i1].username) == 0; };
+
+        g_ui.mentionTag = "@" + g_ui.users[0].username;
+
+        std::string text;
+
         // generate random channel messages
         for (auto & channel : g_ui.channels) {
+            // the channels are filled from the chat log instead
+            if (fnameLogs) break;
+
             auto t = tGet() - 24*3600*(rand()%100 + 10);
 
             int lastUid = -1;
-            int logId = 1 + rand()%(logs.size() - 2);
+            int logId = 1 + rand()%(logsSize - 2);
             const int nMessages = rand()%100 + 10;
 
             for (int i = 0; i < nMessages; ++i) {
-                const bool isSameUser = (logs[logId - 1].username == logs[logId].username);
+                const bool isSameUser = logSameUser(logId - 1, logId);
 
                 int uid = lastUid == -1 || !isSameUser ? rand()%g_ui.users.size() : lastUid;
                 while (!isSameUser && uid == lastUid) {
@@ -1800,30 +2277,34 @@ int main() {
                 int nReactUp   = rand()%100 > 80 ? rand()%5 : 0;
                 int nReactDown = rand()%100 > 90 ? rand()%5 : 0;
 
-                if (logs[logId + 1].username == logs[logId].username) {
+                if (logSameUser(logId + 1, logId)) {
                     nReactUp = 0;
                     nReactDown = 0;
                 }
 
-                channel.messages.push_back({ {
-                    t, uid, logs[logId].text, nReactUp, nReactDown, }, {}
-                });
+                // from time to time, mention the local user
+                std::string_view body = logText(logId);
+                if (uid != 0 && rand()%40 == 0) {
+                    text = g_ui.mentionTag + " ";
+                    text += body;
+                    body = text;
+                }
+
+                const int msg = channel.messages.add(t, uid, body, nReactUp, nReactDown);
 
                 // random threads
                 const int nReplies = rand()%100 > 90 ? rand()%30 : 0;
                 for (int j = 0; j < nReplies; ++j) {
                     t += rand()%60;
-                    logId = std::max((int)((logId + 1)%(logs.size() - 1)), 1);
+                    logId = std::max((int)((logId + 1)%(logsSize - 1)), 1);
 
                     nReactUp   = rand()%100 > 80 ? rand()%5 : 0;
                     nReactDown = rand()%100 > 90 ? rand()%5 : 0;
 
-                    channel.messages.back().replies.push_back({ {
-                        t, (int) (rand()%g_ui.users.size()), logs[logId].text, 0, 0,
-                    }, {} });
+                    channel.messages.addReply(msg, t, rand()%g_ui.users.size(), logText(logId));
                 }
 
-                logId = std::max((int)((logId + 1)%(logs.size() - 1)), 1);
+                logId = std::max((int)((logId + 1)%(logsSize - 1)), 1);
             }
         }
 
@@ -1834,11 +2315,11 @@ int main() {
             auto t = tGet() - 24*3600*(rand()%100 + 10);
 
             int lastUid = -1;
-            int logId = 1 + rand()%(logs.size() - 2);
+            int logId = 1 + rand()%(logsSize - 2);
             const int nMessages = rand()%100 + 10;
 
             for (int i = 0; i < nMessages; ++i) {
-                const bool isSameUser = (logs[logId - 1].username == logs[logId].username);
+                const bool isSameUser = logSameUser(logId - 1, logId);
 
                 int uid = lastUid == -1 || !isSameUser ? rand()%g_ui.users.size() : lastUid;
                 while (!isSameUser && (uid == lastUid || (uid != 0 && uid != user.id))) {
@@ -1855,18 +2336,43 @@ int main() {
                 int nReactUp   = rand()%100 > 80 ? rand()%5 : 0;
                 int nReactDown = rand()%100 > 90 ? rand()%5 : 0;
 
-                if (logs[logId + 1].username == logs[logId].username) {
+                if (logSameUser(logId + 1, logId)) {
                     nReactUp = 0;
                     nReactDown = 0;
                 }
 
-                user.messages.push_back({ {
-                    t, uid, logs[logId].text, nReactUp, nReactDown, }, {}
-                });
+                user.messages.add(t, uid, logText(logId), nReactUp, nReactDown);
 
-                logId = std::max((int)((logId + 1)%(logs.size() - 1)), 1);
+                logId = std::max((int)((logId + 1)%(logsSize - 1)), 1);
             }
         }
+
+        // everything has been read, except for the latest messages in a few conversations
+        {
+            for (auto & channel : g_ui.channels) {
+                channel.read.markRead(channel.messages.size());
+            }
+
+            for (auto & user : g_ui.users) {
+                user.read.markRead(user.messages.size());
+            }
+
+            for (int i : { 3, 5, 8, 9 }) {
+                auto & channel = g_ui.channels[i];
+                g_ui.markUnread(channel, std::max(0, channel.messages.size() - 1 - rand()%20));
+            }
+
+            auto & user = g_ui.users[3];
+            g_ui.markUnread(user, std::max(0, user.messages.size() - 1 - rand()%5));
+        }
+    }
+
+    g_searchIndex.start();
+
+    if (firehoseRate > 0) {
+        g_firehose.rate = firehoseRate;
+        g_firehose.start(g_ui.channels.size(), g_ui.users.size(), g_logs.size());
+        g_ui.showFirehose = true;
     }
 
     IMGUI_CHECKVERSION();
@@ -1892,6 +2398,10 @@ int main() {
 
     ImTui_ImplText_Shutdown();
     ImTui_ImplNcurses_Shutdown();
+
+    g_firehose.stop();
+    g_searchIndex.stop();
+    g_logLoader.close();
 #endif
 
     return 0;
@@ -0,0 +1,153 @@
+/*! \file message-store.h
+ *  \brief Columnar message storage
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// fixed-width message columns - row i of each column belongs to the same message
+struct MessageColumns {
+    std::vector<int32_t>  t_s;       // timestamp in seconds
+    std::vector<int32_t>  uid;       // userId
+    std::vector<uint16_t> reactUp;
+    std::vector<uint16_t> reactDown;
+    std::vector<int32_t>  parent;    // row of the thread root, -1 for top-level messages
+    std::vector<uint32_t> textBegin; // offset of the message body in the text arena
+    std::vector<uint32_t> textSize;
+
+    inline int size() const { return (int) t_s.size(); }
+
+    inline void reserve(int n) {
+        t_s.reserve(n);
+        uid.reserve(n);
+        reactUp.reserve(n);
+        reactDown.reserve(n);
+        parent.reserve(n);
+        textBegin.reserve(n);
+        textSize.reserve(n);
+    }
+
+    inline int push(int32_t t, int32_t u, int32_t up, int32_t down, int32_t p, uint32_t begin, uint32_t size) {
+        t_s.push_back(t);
+        uid.push_back(u);
+        reactUp.push_back(up);
+        reactDown.push_back(down);
+        parent.push_back(p);
+        textBegin.push_back(begin);
+        textSize.push_back(size);
+
+        return (int) t_s.size() - 1;
+    }
+
+    inline void set(int i, int32_t t, int32_t u, int32_t up, int32_t down, int32_t p, uint32_t begin, uint32_t size) {
+        t_s[i] = t;
+        uid[i] = u;
+        reactUp[i] = up;
+        reactDown[i] = down;
+        parent[i] = p;
+        textBegin[i] = begin;
+        textSize[i] = size;
+    }
+};
+
+// messages of a single conversation (channel or DM)
+//
+// Top-level messages and thread replies live in two separate column sets. The bodies of all messages are stored
+// back-to-back in a single string arena (each one is null-terminated, so it can be passed directly to printf-style
+// functions). A thread is a contiguous range of rows in the replies columns, with room to grow after it.
+struct MessageStore {
+    MessageColumns messages;
+    MessageColumns replies;
+
+    // per top-level message: [threadBegin, threadEnd) rows in "replies", the thread can grow up to threadCap rows
+    std::vector<int32_t> threadBegin;
+    std::vector<int32_t> threadEnd;
+    std::vector<int32_t> threadCap;
+
+    // rows in "replies" in the order the replies were added - rows of moved threads stay valid, they are not reused
+    std::vector<int32_t> replyRows;
+
+    std::string text;
+
+    inline int size() const { return messages.size(); }
+    inline int nReplies(int msg) const { return threadEnd[msg] - threadBegin[msg]; }
+
+    inline const char * getText(const MessageColumns & rows, int i) const { return text.data() + rows.textBegin[i]; }
+    inline std::string_view getTextView(const MessageColumns & rows, int i) const { return { getText(rows, i), rows.textSize[i] }; }
+
+    inline void reserve(int nMessages, int nReplies, int nTextBytes) {
+        messages.reserve(nMessages);
+        replies.reserve(nReplies);
+        threadBegin.reserve(nMessages);
+        threadEnd.reserve(nMessages);
+        threadCap.reserve(nMessages);
+        replyRows.reserve(nReplies);
+        text.reserve(nTextBytes);
+    }
+
+    // append a top-level message, returns its row
+    inline int add(int32_t t_s, int32_t uid, std::string_view body, int32_t reactUp = 0, int32_t reactDown = 0) {
+        const uint32_t begin = addText(body);
+        threadBegin.push_back(replies.size());
+        threadEnd.push_back(replies.size());
+        threadCap.push_back(0);
+
+        return messages.push(t_s, uid, reactUp, reactDown, -1, begin, body.size());
+    }
+
+    // append a reply to the thread of top-level message "msg", returns its row in "replies"
+    inline int addReply(int msg, int32_t t_s, int32_t uid, std::string_view body, int32_t reactUp = 0, int32_t reactDown = 0) {
+        auto & begin = threadBegin[msg];
+        auto & end   = threadEnd[msg];
+        auto & cap   = threadCap[msg];
+
+        const uint32_t textBegin = addText(body);
+
+        if (end == begin + cap) {
+            if (end == replies.size()) {
+                // the last thread - just grow
+                ++cap;
+            } else {
+                // Keep the thread contiguous: another thread was appended after it, so move its rows to the back,
+                // with room for as many replies again. The moving costs O(1) per reply on average, and the dead rows
+                // left behind are about twice the live ones at most. The bodies are not copied - the moved rows keep pointing to the same
+                // place in the arena.
+                const int n = end - begin;
+                const int newCap = std::max(4, 2*(n + 1));
+                for (int i = begin; i < end; ++i) {
+                    replies.push(replies.t_s[i], replies.uid[i], replies.reactUp[i], replies.reactDown[i],
+                                 replies.parent[i], replies.textBegin[i], replies.textSize[i]);
+                }
+                for (int i = n; i < newCap; ++i) {
+                    replies.push(0, 0, 0, 0, msg, 0, 0);
+                }
+                begin = replies.size() - newCap;
+                end   = begin + n;
+                cap   = newCap;
+            }
+        }
+
+        if (end == replies.size()) {
+            replies.push(t_s, uid, reactUp, reactDown, msg, textBegin, body.size());
+        } else {
+            replies.set(end, t_s, uid, reactUp, reactDown, msg, textBegin, body.size());
+        }
+        replyRows.push_back(end);
+
+        return end++;
+    }
+
+    private:
+    inline uint32_t addText(std::string_view body) {
+        const uint32_t begin = text.size();
+        text.append(body);
+        text.push_back(0);
+
+        return begin;
+    }
+};
@@ -0,0 +1,357 @@
+/*! \file search-index.h
+ *  \brief Incremental full-text search over the message stores
+ */
+
+#pragma once
+
+#include "message-store.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// a searchable message
+struct SearchDoc {
+    int32_t conv;  // conversation id - the meaning is up to the caller (e.g. channels first, then DMs)
+    int32_t msg;   // top-level message row - for thread replies this is the row of the thread root
+    int32_t uid;   // author
+
+    uint32_t textBegin; // location of the body in the text arena of the conversation's MessageStore
+    uint32_t textSize;
+
+    bool isReply;
+};
+
+// how much of a MessageStore has already been passed to the index
+struct SearchCursor {
+    int nMessages = 0;
+    int nReplies  = 0;
+};
+
+// Inverted index over the message bodies:
+//
+//   - words    : lower-case alphanumeric token -> ids of the documents that contain it
+//   - trigrams : 3 consecutive lower-case characters -> ids of the documents that contain them
+//
+// The documents get increasing ids, so all posting lists are sorted and new documents are simply appended to them.
+// Queries with words shorter than 3 characters match whole words, longer ones match substrings - the trigram
+// postings give the candidates, which are then verified against the actual text.
+//
+// New documents are queued with add() and indexed on a worker thread. Queries run on the caller's thread and only
+// wait for the worker to finish the document that it is currently inserting.
+struct SearchIndex {
+    static constexpr int kMaxResults = 4096;
+
+    // Verifying a candidate scans its text. Queries whose candidates mostly fail the verification (e.g. the
+    // trigrams match, the word does not) stop after this many, so a query stays within a few ms at any size.
+    static constexpr int kMaxVerified = 16384;
+
+    ~SearchIndex() { stop(); }
+
+    void start() {
+#ifndef __EMSCRIPTEN__
+        isRunning = true;
+        worker = std::thread([this]() {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(pendingMutex);
+                    cvPending.wait(lock, [this]() { return pendingDocs.empty() == false || isRunning == false; });
+                    if (isRunning == false) break;
+                }
+                update(-1.0f);
+            }
+        });
+#endif
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            isRunning = false;
+        }
+        cvPending.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    // queue a document for indexing - the text is copied
+    void add(const SearchDoc & doc, std::string_view text) {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pendingDocs.push_back(doc);
+        pendingText.push_back(std::string(text));
+    }
+
+    // queue the messages that were added to "store" since the last call
+    void add(int32_t conv, const MessageStore & store, SearchCursor & cursor) {
+        const auto & messages = store.messages;
+        const auto & replies  = store.replies;
+
+        if (cursor.nMessages == messages.size() && cursor.nReplies == (int) store.replyRows.size()) {
+            return;
+        }
+
+        for (int i = cursor.nMessages; i < messages.size(); ++i) {
+            add({ conv, i, messages.uid[i], messages.textBegin[i], messages.textSize[i], false }, store.getTextView(messages, i));
+        }
+
+        for (int k = cursor.nReplies; k < (int) store.replyRows.size(); ++k) {
+            const int i = store.replyRows[k];
+            add({ conv, replies.parent[i], replies.uid[i], replies.textBegin[i], replies.textSize[i], true }, store.getTextView(replies, i));
+        }
+
+        cursor.nMessages = messages.size();
+        cursor.nReplies  = store.replyRows.size();
+
+        cvPending.notify_one();
+    }
+
+    // index the queued documents - called by the worker thread, or from the main loop when there are no threads
+    // budget_ms < 0 means no limit
+    void update(float budget_ms) {
+        const auto tStart = std::chrono::steady_clock::now();
+
+        std::vector<SearchDoc> batchDocs;
+        std::vector<std::string> batchText;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            if (pendingDocs.empty()) return;
+
+            batchDocs.swap(pendingDocs);
+            batchText.swap(pendingText);
+        }
+
+        std::string lower;
+
+        size_t i = 0;
+        for (; i < batchDocs.size(); ++i) {
+            toLower(batchText[i], lower);
+
+            std::unique_lock<std::shared_mutex> lock(indexMutex);
+
+            const uint32_t docId = docs.size();
+            docs.push_back(batchDocs[i]);
+
+            forEachWord(lower, [&](std::string_view word) {
+                auto it = words.find(word);
+                if (it == words.end()) {
+                    it = words.emplace(std::string(word), std::vector<uint32_t>()).first;
+                }
+                if (it->second.empty() || it->second.back() != docId) {
+                    it->second.push_back(docId);
+                }
+            });
+
+            for (size_t j = 0; j + 2 < lower.size(); ++j) {
+                auto & posting = trigrams[trigramKey(lower.data() + j)];
+                if (posting.empty() || posting.back() != docId) {
+                    posting.push_back(docId);
+                }
+            }
+
+            if (budget_ms >= 0.0f && (i & 63) == 63) {
+                const auto tNow = std::chrono::steady_clock::now();
+                if (std::chrono::duration<float, std::milli>(tNow - tStart).count() > budget_ms) {
+                    ++i;
+                    break;
+                }
+            }
+        }
+
+        // put back whatever did not fit in the budget, in front of the documents that were queued in the meantime
+        if (i < batchDocs.size()) {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            pendingDocs.insert(pendingDocs.begin(), batchDocs.begin() + i, batchDocs.end());
+            pendingText.insert(pendingText.begin(), std::make_move_iterator(batchText.begin() + i), std::make_move_iterator(batchText.end()));
+        }
+    }
+
+    int nDocs() const {
+        std::shared_lock<std::shared_mutex> lock(indexMutex);
+        return docs.size();
+    }
+
+    int nPending() const {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        return pendingDocs.size();
+    }
+
+    // find the documents that contain all words of "query", newest first
+    // getText(doc) must return the current body of the document
+    // returns false if the search stopped early - at kMaxResults results or kMaxVerified candidates
+    template <typename F>
+    bool query(std::string_view query, std::vector<SearchDoc> & res, F && getText) const {
+        res.clear();
+
+        std::string lower;
+        toLower(query, lower);
+
+        std::vector<std::string_view> needles; // words that have to be verified as substrings
+        std::vector<const std::vector<uint32_t> *> postings;
+
+        std::shared_lock<std::shared_mutex> lock(indexMutex);
+
+        bool isEmpty = true;
+        bool isMissing = false;
+        forEachWord(lower, [&](std::string_view word) {
+            isEmpty = false;
+            if (word.size() < 3) {
+                const auto it = words.find(word);
+                if (it == words.end()) {
+                    isMissing = true;
+                    return;
+                }
+                postings.push_back(&it->second);
+            } else {
+                // non-overlapping trigrams are enough to narrow down the candidates - the verification does the rest
+                for (size_t j = 0; j < word.size(); j += 3) {
+                    const auto it = trigrams.find(trigramKey(word.data() + std::min(j, word.size() - 3)));
+                    if (it == trigrams.end()) {
+                        isMissing = true;
+                        return;
+                    }
+                    postings.push_back(&it->second);
+                }
+                needles.push_back(word);
+            }
+        });
+
+        if (isEmpty || isMissing) {
+            return true;
+        }
+
+        // walk the shortest posting list from the newest document and look up the rest
+        // the lookups move backwards through the other lists, so each one only searches below the previous position
+        std::sort(postings.begin(), postings.end(), [](const auto * a, const auto * b) { return a->size() < b->size(); });
+        postings.erase(std::unique(postings.begin(), postings.end()), postings.end());
+
+        std::vector<size_t> ends(postings.size());
+        for (size_t j = 0; j < postings.size(); ++j) {
+            ends[j] = postings[j]->size();
+        }
+
+        int nVerified = 0;
+
+        const auto & candidates = *postings[0];
+        for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+            if ((int) res.size() == kMaxResults || nVerified == kMaxVerified) {
+                return false;
+            }
+
+            const uint32_t docId = *it;
+
+            bool isMatch = true;
+            for (size_t j = 1; j < postings.size() && isMatch; ++j) {
+                isMatch = gallopBackwards(*postings[j], ends[j], docId);
+            }
+            if (isMatch == false) continue;
+
+            const auto & doc = docs[docId];
+            if (needles.empty() == false) {
+                ++nVerified;
+
+                const std::string_view text = getText(doc);
+                for (size_t j = 0; j < needles.size() && isMatch; ++j) {
+                    isMatch = containsNoCase(text, needles[j]);
+                }
+            }
+
+            if (isMatch) {
+                res.push_back(doc);
+            }
+        }
+
+        return true;
+    }
+
+    private:
+    static inline char lowerChar(char ch) {
+        return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+    }
+
+    static inline bool isWordChar(char ch) {
+        return (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'Z');
+    }
+
+    static inline uint32_t trigramKey(const char * p) {
+        return (uint32_t(uint8_t(p[0])) << 16) | (uint32_t(uint8_t(p[1])) << 8) | uint32_t(uint8_t(p[2]));
+    }
+
+    static void toLower(std::string_view src, std::string & dst) {
+        dst.resize(src.size());
+        for (size_t i = 0; i < src.size(); ++i) {
+            dst[i] = lowerChar(src[i]);
+        }
+    }
+
+    template <typename F>
+    static void forEachWord(std::string_view text, F && cb) {
+        size_t i = 0;
+        while (i < text.size()) {
+            while (i < text.size() && isWordChar(text[i]) == false) ++i;
+            const size_t begin = i;
+            while (i < text.size() && isWordChar(text[i])) ++i;
+            if (i > begin) {
+                cb(text.substr(begin, i - begin));
+            }
+        }
+    }
+
+    // check if "val" is in posting[0, end) and move "end" to its position
+    // exponential search from the back, because consecutive lookups are for decreasing values that are usually close
+    static bool gallopBackwards(const std::vector<uint32_t> & posting, size_t & end, uint32_t val) {
+        size_t hi = end;
+        size_t step = 1;
+        while (hi >= step && posting[hi - step] > val) {
+            hi -= step;
+            step *= 2;
+        }
+        const size_t lo = hi >= step ? hi - step : 0;
+
+        end = std::lower_bound(posting.begin() + lo, posting.begin() + hi, val) - posting.begin();
+
+        return end < posting.size() && posting[end] == val;
+    }
+
+    // "needle" is already lower-case
+    static bool containsNoCase(std::string_view text, std::string_view needle) {
+        if (needle.size() > text.size()) return false;
+
+        for (size_t i = 0; i + needle.size() <= text.size(); ++i) {
+            if (lowerChar(text[i]) != needle[0]) continue;
+
+            size_t j = 1;
+            while (j < needle.size() && lowerChar(text[i + j]) == needle[j]) ++j;
+            if (j == needle.size()) return true;
+        }
+
+        return false;
+    }
+
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+    };
+
+    std::vector<SearchDoc> docs;
+    std::unordered_map<std::string, std::vector<uint32_t>, StringHash, std::equal_to<>> words;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+
+    mutable std::shared_mutex indexMutex;
+
+    bool isRunning = false;
+    std::thread worker;
+
+    mutable std::mutex pendingMutex;
+    std::condition_variable cvPending;
+    std::vector<SearchDoc> pendingDocs;
+    std::vector<std::string> pendingText;
+};
@@ -0,0 +1,63 @@
+/*! \file spsc-queue.h
+ *  \brief Lock-free single-producer / single-consumer queue
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// bounded single-producer / single-consumer ring buffer
+template <typename T>
+struct SpscQueue {
+    explicit SpscQueue(int capacityLog2) : mask((uint64_t(1) << capacityLog2) - 1), data(mask + 1) {}
+
+    // returns false if the queue is full
+    bool push(const T & v) {
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+        data[t & mask] = v;
+        tail.store(t + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // "v" is moved from only if there is room for it
+    bool push(T && v) {
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) {
+            return false;
+        }
+        data[t & mask] = std::move(v);
+        tail.store(t + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // returns false if the queue is empty
+    bool pop(T & v) {
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        v = std::move(data[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    int size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    private:
+    const uint64_t mask;
+    std::vector<T> data;
+
+    alignas(64) std::atomic<uint64_t> head = 0;
+    alignas(64) std::atomic<uint64_t> tail = 0;
+};
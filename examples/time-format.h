@@ -0,0 +1,164 @@
+/*! \file time-format.h
+ *  \brief Cached formatting of timestamps
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Formats timestamps without calling localtime() and allocating strings for every rendered item.
+//
+// The local days that have been seen are kept in a table with their [t0, t1) range and preformatted date, so the
+// date of a timestamp is a lookup and its "hh:mm" is an index into a table of 24*60 strings. Days that are not
+// exactly 24 hours long (DST switches) use localtime() for the time of day. The table is dropped when the UTC offset
+// changes - update() checks for that every minute and at midnight.
+struct TimeFormat {
+    struct Day {
+        int64_t t0; // local midnight
+        int64_t t1; // next local midnight
+
+        int32_t id; // unique for each day in the table - cheap to compare
+
+        char date[64];
+    };
+
+    TimeFormat() {
+        for (int i = 0; i < 24*60; ++i) {
+            snprintf(hhmm[i], sizeof(hhmm[i]), "%02d:%02d", i/60, i%60);
+        }
+
+        auto add = [this](const char * unit, int n) {
+            for (int i = 0; i < n; ++i) {
+                sinceStrings.push_back(std::to_string(i) + " " + unit);
+            }
+        };
+
+        add("seconds", 60);
+        add("minutes", 60);
+        add("hours",   24);
+    }
+
+    // call once per frame - drops the cached days when the timezone changes
+    void update(int64_t tNow_s) {
+        if (tNow_s < tNextCheck_s) {
+            return;
+        }
+
+        const int64_t offset_s = utcOffset(tNow_s);
+        if (offset_s != curOffset_s) {
+            days.clear();
+            sorted.clear();
+            lastDay = -1;
+            curOffset_s = offset_s;
+        }
+
+        tNextCheck_s = std::min(tNow_s + 60, day(tNow_s).t1);
+    }
+
+    const Day & day(int64_t t_s) {
+        if (lastDay >= 0 && days[lastDay].t0 <= t_s && t_s < days[lastDay].t1) {
+            return days[lastDay];
+        }
+
+        auto it = std::upper_bound(sorted.begin(), sorted.end(), t_s, [this](int64_t t, int i) { return t < days[i].t0; });
+        if (it != sorted.begin() && t_s < days[*(it - 1)].t1) {
+            lastDay = *(it - 1);
+            return days[lastDay];
+        }
+
+        Day res;
+
+        time_t t = t_s;
+        struct tm tm = *localtime(&t);
+        strftime(res.date, sizeof(res.date), "%A, %B %d", &tm);
+
+        tm.tm_hour = 0;
+        tm.tm_min = 0;
+        tm.tm_sec = 0;
+        tm.tm_isdst = -1;
+        res.t0 = mktime(&tm);
+
+        tm.tm_mday += 1;
+        tm.tm_isdst = -1;
+        res.t1 = mktime(&tm);
+
+        res.id = nextId++;
+
+        lastDay = days.size();
+        days.push_back(res);
+        sorted.insert(it, lastDay);
+
+        return days[lastDay];
+    }
+
+    // [Friday, July 22]
+    const char * date(int64_t t_s) {
+        return day(t_s).date;
+    }
+
+    // [hh:mm]
+    // the result is valid until the next call
+    const char * time(int64_t t_s) {
+        const auto & d = day(t_s);
+        if (d.t1 - d.t0 == 24*3600) {
+            return hhmm[(t_s - d.t0)/60];
+        }
+
+        time_t t = t_s;
+        strftime(buf, sizeof(buf), "%H:%M", localtime(&t));
+        return buf;
+    }
+
+    // [5 minutes]
+    // the result stays valid for the lifetime of the formatter
+    const char * since(int64_t delta_s) {
+        delta_s = std::max<int64_t>(delta_s, 0);
+
+        if (delta_s < 60)      return sinceStrings[delta_s].c_str();
+        if (delta_s < 3600)    return sinceStrings[60 + delta_s/60].c_str();
+        if (delta_s < 24*3600) return sinceStrings[120 + delta_s/3600].c_str();
+
+        const size_t idx = 144 + delta_s/24/3600;
+        while (sinceStrings.size() <= idx) {
+            sinceStrings.push_back(std::to_string(sinceStrings.size() - 144) + " days");
+        }
+
+        return sinceStrings[idx].c_str();
+    }
+
+    private:
+    static int64_t utcOffset(int64_t t_s) {
+        time_t t = t_s;
+        const struct tm lt = *localtime(&t);
+        const struct tm gt = *gmtime(&t);
+
+        int64_t res = ((lt.tm_hour - gt.tm_hour)*60 + (lt.tm_min - gt.tm_min))*60;
+        if (lt.tm_year != gt.tm_year) {
+            res += lt.tm_year > gt.tm_year ? 24*3600 : -24*3600;
+        } else if (lt.tm_yday != gt.tm_yday) {
+            res += lt.tm_yday > gt.tm_yday ? 24*3600 : -24*3600;
+        }
+
+        return res;
+    }
+
+    int64_t tNextCheck_s = 0;
+    int64_t curOffset_s  = 0;
+
+    std::deque<Day>  days;   // references stay valid when new days are added
+    std::vector<int> sorted; // indices into "days", ordered by t0
+
+    int lastDay = -1;
+    int32_t nextId = 0;
+
+    char hhmm[24*60][6];
+    char buf[16];
+
+    std::deque<std::string> sinceStrings; // a deque, so that adding days does not move the returned strings
+};
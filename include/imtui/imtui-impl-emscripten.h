@@ -4,14 +4,34 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace ImTui {
 struct TScreen;
+using TCell = uint32_t;
 }
 
-ImTui::TScreen * ImTui_ImplEmscripten_Init(bool mouseSupport);
+// fps_idle - frame rate when nothing changes, 0 - render only on input or ImTui_ImplEmscripten_RequestRedraw()
+ImTui::TScreen * ImTui_ImplEmscripten_Init(bool mouseSupport, float fps_idle = 0.0f);
 void ImTui_ImplEmscripten_Shutdown();
 void ImTui_ImplEmscripten_NewFrame();
 
+// Call after ImTui_ImplText_RenderDrawData(). Finds the rows that changed since the last call and bumps the frame
+// sequence number if there are any - see get_screen_frame() and get_screen_dirty_rows().
+// active - the app has more work for the next frames, keep rendering at full rate
+void ImTui_ImplEmscripten_DrawScreen(bool active = false);
+
+// Wake up the host - e.g. when data arrives in a callback. Calls Module.requestFrame() if the page defines it.
+void ImTui_ImplEmscripten_RequestRedraw();
+
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+// Worker build - call at the end of main() in the worker (e.g. with -s PROXY_TO_PTHREAD=1). Renders the frames with
+// renderFrame() when get_frame_delay_ms() says so and publishes them to the page through get_frame_ring(). The worker
+// sleeps while there is nothing to render, the input and ImTui_ImplEmscripten_RequestRedraw() wake it up. Does not
+// return - the thread keeps running the callbacks of the app, e.g. the fetches.
+void ImTui_ImplEmscripten_RunInWorker(bool (*renderFrame)());
+#endif
+
 extern "C" {
     void set_mouse_pos(float x, float y);
     void set_mouse_down(int but, float x, float y);
@@ -23,5 +43,44 @@ extern "C" {
     void set_key_up(int key);
     void set_key_press(int key);
 
+    // when to render the next frame: 0 - on the next animation frame, N - in N ms, -1 - on the next input
+    // or redraw request
+    int get_frame_delay_ms();
+
     void get_screen(char * buffer);
+
+    // Zero-copy access to the screen: one TCell per character - char in bits 0-15, fg in 16-23, bg in 24-31.
+    // The data and the dirty-row bitmap are valid until the next frame.
+    ImTui::TCell * get_screen_data();
+    int get_screen_nx();
+    int get_screen_ny();
+    uint32_t get_screen_frame();
+    uint32_t * get_screen_dirty_rows();
+
+    // The dirty rows as runs of characters with the same colors, one after the other:
+    //
+    //   u16 row | u16 col | u16 n | u8 fg | u8 bg | n chars (little-endian)
+    //
+    // Valid until the next frame.
+    uint8_t * get_screen_delta();
+    int get_screen_delta_size();
+
+    // All rows of a screen supplied by the caller, in the same format - works without a running app, e.g. to test
+    // the format from Node (tests/screen-delta.js). Valid until the next call.
+    uint8_t * encode_screen(const ImTui::TCell * cells, int nx, int ny, int * size);
+
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+    // Worker build, with ImTui_ImplEmscripten_RunInWorker() - the frames are rendered in a Web Worker and the page in
+    // the main thread reads them from the shared memory. The input functions above can be called from the main thread.
+    // The apps that render in the main thread do not use the ring, even in the worker build.
+    //
+    // The ring is a triple buffer of finished frames, all fields are 32-bit:
+    //
+    //   i32 middle | u32 paintedSeq | 3 x slot: u32 seq | i32 nx | i32 ny | u32 cells | u32 delta | i32 deltaSize
+    //
+    // The page starts with front slot 2. When "middle" has bit 2 set, the page swaps it with its front slot using
+    // Atomics.exchange(), paints the delta of the slot (same format as above) and stores its seq in "paintedSeq".
+    // The delta holds all rows that changed since paintedSeq. The slot is not touched until the page gives it back.
+    void * get_frame_ring();
+#endif
 }
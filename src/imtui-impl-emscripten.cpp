@@ -8,6 +8,20 @@
 
 #include <emscripten.h>
 
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+#include <emscripten/eventloop.h>
+#include <emscripten/proxying.h>
+#include <pthread.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
 // client input
 static bool ignoreMouse = false;
 static ImVec2 lastMousePos = { 0.0, 0.0 };
@@ -16,10 +30,161 @@ static float lastMouseWheel = 0.0;
 static float lastMouseWheelH = 0.0;
 
 static ImTui::TScreen * g_screen = nullptr;
-static char lastAddText[8];
 static bool lastKeysDown[512];
 
-ImTui::TScreen * ImTui_ImplEmscripten_Init(bool mouseSupport) {
+// the input received since the last frame, in order
+struct InputEvent {
+    enum Type : uint8_t {
+        MousePos,
+        MouseDown,
+        MouseUp,
+        MouseWheel,
+        KeyDown,
+        KeyUp,
+        KeyPress,
+        ScreenSize,
+    };
+
+    Type type;
+    int key;  // or mouse button
+    float x;
+    float y;
+};
+
+// In the worker build the page pushes the input from the main thread, while the frames are rendered in the worker.
+static std::mutex eventsMutex;
+static std::vector<InputEvent> events;
+static ImVec2 lastInputMousePos = { 0.0, 0.0 }; // of the last queued event, the position the page knows about
+
+// Render on demand - after input, a redraw request or a change on the screen, the host renders on every animation
+// frame for a while. Then it slows down to the idle frame rate, or stops until the next event.
+static std::atomic<int> nActiveFrames { 10 };
+static float tStepIdle_ms = 0.0f;
+static double tLastFrame_ms = 0.0;
+
+// the last drawn frame - the host reads the screen straight from g_screen and redraws only the dirty rows
+static ImTui::TScreen screenPrev;
+static uint32_t frameSeq = 0;
+static std::vector<uint32_t> dirtyRows; // bitmap, 1 bit per row
+static std::vector<uint8_t> delta;      // the dirty rows, see encodeRow()
+static std::vector<uint8_t> encoded;    // see encode_screen()
+
+// Append a row to the delta as runs of characters with the same colors:
+//
+//   u16 row | u16 col | u16 n | u8 fg | u8 bg | n chars
+//
+// The numbers are little-endian. Characters that the page cannot show are replaced by spaces.
+static void encodeRow(const ImTui::TCell * cells, int nx, int y, std::vector<uint8_t> & dst) {
+    auto put16 = [&](int v) {
+        dst.push_back(v & 0xFF);
+        dst.push_back((v >> 8) & 0xFF);
+    };
+
+    int x = 0;
+    while (x < nx) {
+        const uint32_t colors = cells[x] & 0xFFFF0000;
+
+        int n = 1;
+        while (x + n < nx && (cells[x + n] & 0xFFFF0000) == colors) ++n;
+
+        put16(y);
+        put16(x);
+        put16(n);
+        dst.push_back((colors >> 16) & 0xFF);
+        dst.push_back((colors >> 24) & 0xFF);
+
+        for (int i = x; i < x + n; ++i) {
+            const uint32_t c = cells[i] & 0xFFFF;
+            dst.push_back(c > 10 && c < 128 ? c : ' ');
+        }
+
+        x += n;
+    }
+}
+
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+// The finished frames, for the page in the main thread - a triple buffer in the shared memory. The worker fills its
+// back slot and swaps it with the middle one, the page swaps its front slot with the middle one when it is fresh.
+// Nobody waits, and the page always gets the latest frame. The delta in a slot holds all rows that changed since the
+// last frame the page painted, so the frames it never saw need no special handling.
+struct FrameSlot {
+    uint32_t seq = 0;
+    int32_t nx = 0;
+    int32_t ny = 0;
+    ImTui::TCell * cells = nullptr;
+    uint8_t * delta = nullptr;
+    int32_t deltaSize = 0;
+};
+
+struct FrameRing {
+    static constexpr int32_t kFresh = 4; // the middle slot has not been taken by the page yet
+
+    std::atomic<int32_t> middle { 1 };
+    std::atomic<uint32_t> paintedSeq { 0 }; // written by the page
+    FrameSlot slots[3];
+};
+
+static_assert(sizeof(void *) != 4 || sizeof(FrameRing) == 8 + 3*24, "the page reads the ring at fixed offsets");
+
+static FrameRing frameRing;
+static std::atomic<bool> isRingEnabled { false }; // by ImTui_ImplEmscripten_RunInWorker()
+static int ringBack = 0;
+static std::vector<ImTui::TCell> ringCells[3];
+static std::vector<uint8_t> ringDelta[3];
+
+// the dirty rows of the last frames, to find the rows that changed since the last painted one
+static constexpr uint32_t kHistory = 16;
+static std::vector<uint32_t> dirtyHistory[kHistory];
+static std::vector<uint32_t> ringDirty;
+
+static void publishFrame() {
+    const int nx = g_screen->nx;
+    const int ny = g_screen->ny;
+
+    dirtyHistory[frameSeq % kHistory] = dirtyRows;
+
+    // The page may paint a newer frame in the meantime - then more rows are sent than needed, which is harmless.
+    const uint32_t paintedSeq = frameRing.paintedSeq.load();
+    if (paintedSeq == 0 || frameSeq - paintedSeq > kHistory) {
+        ringDirty.assign(dirtyRows.size(), 0xFFFFFFFF);
+    } else {
+        ringDirty.assign(dirtyRows.size(), 0);
+        for (uint32_t seq = paintedSeq + 1; seq != frameSeq + 1; ++seq) {
+            const auto & dirty = dirtyHistory[seq % kHistory];
+            for (size_t i = 0; i < std::min(dirty.size(), ringDirty.size()); ++i) {
+                ringDirty[i] |= dirty[i];
+            }
+        }
+    }
+
+    auto & cells = ringCells[ringBack];
+    auto & delta = ringDelta[ringBack];
+
+    cells.assign(g_screen->data, g_screen->data + nx*ny);
+    delta.clear();
+    for (int y = 0; y < ny; ++y) {
+        if (ringDirty[y/32] & (1u << (y%32))) {
+            encodeRow(cells.data() + y*nx, nx, y, delta);
+        }
+    }
+
+    auto & slot = frameRing.slots[ringBack];
+    slot.seq = frameSeq;
+    slot.nx = nx;
+    slot.ny = ny;
+    slot.cells = cells.data();
+    slot.delta = delta.data();
+    slot.deltaSize = delta.size();
+
+    ringBack = frameRing.middle.exchange(ringBack | FrameRing::kFresh) & 3;
+
+    MAIN_THREAD_ASYNC_EM_ASM({
+        if (Module.requestFrame) Module.requestFrame();
+    });
+}
+#endif
+
+ImTui::TScreen * ImTui_ImplEmscripten_Init(bool mouseSupport, float fps_idle) {
     if (g_screen == nullptr) {
         g_screen = new ImTui::TScreen();
     }
@@ -49,6 +214,8 @@ ImTui::TScreen * ImTui_ImplEmscripten_Init(bool mouseSupport) {
 
     ignoreMouse = !mouseSupport;
 
+    tStepIdle_ms = fps_idle > 0.0f ? 1000.0f/fps_idle : 0.0f;
+
     return g_screen;
 }
 
@@ -60,83 +227,131 @@ void ImTui_ImplEmscripten_Shutdown() {
     g_screen = nullptr;
 }
 
-void ImTui_ImplEmscripten_NewFrame() {
-    ImGui::GetIO().MousePos = lastMousePos;
-    ImGui::GetIO().MouseWheelH = lastMouseWheelH;
-    ImGui::GetIO().MouseWheel = lastMouseWheel;
-    ImGui::GetIO().MouseDown[0] = lastMouseDown[0];
-    ImGui::GetIO().MouseDown[1] = lastMouseDown[2]; // right-click in browser is 2
-    ImGui::GetIO().MouseDown[2] = lastMouseDown[1]; // scroll-click in browser is 1
-    ImGui::GetIO().MouseDown[3] = lastMouseDown[3];
-    ImGui::GetIO().MouseDown[4] = lastMouseDown[4];
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+// The frame loop of the worker - a timer for the next frame while one is due, nothing while idle. Input and redraw
+// requests from other threads wake it up through the proxying queue of the worker.
+static constexpr int kMinFrameStep_ms = 16; // there are no animation frames in a worker
+static bool (*workerRenderFrame)() = nullptr;
+static pthread_t workerThread;
+static int workerTimer = 0;
+static std::atomic<bool> isWakePending { false };
 
-    if (strlen(lastAddText) > 0 && (!(lastAddText[0] & 0x80)) ) {
-        ImGui::GetIO().AddInputCharactersUTF8(lastAddText);
-    }
+static void scheduleWorkerFrame();
 
-    for (int i = 0; i < 512; ++i) {
-        ImGui::GetIO().KeysDown[i] = lastKeysDown[i];
-    }
+static void runWorkerFrame(void * ) {
+    workerTimer = 0;
 
-    lastMouseWheelH = 0.0;
-    lastMouseWheel = 0.0;
-    lastAddText[0] = 0;
+    workerRenderFrame();
+    scheduleWorkerFrame();
 }
 
-EMSCRIPTEN_KEEPALIVE
-void set_mouse_pos(float x, float y) {
-    if (ignoreMouse) return;
+static void scheduleWorkerFrame() {
+    if (workerTimer != 0) {
+        emscripten_clear_timeout(workerTimer);
+        workerTimer = 0;
+    }
 
-    lastMousePos.x = x;
-    lastMousePos.y = y;
+    const int delay = get_frame_delay_ms();
+    if (delay < 0) return;
+
+    const double tWait_ms = std::max(delay, kMinFrameStep_ms) - (emscripten_get_now() - tLastFrame_ms);
+    workerTimer = emscripten_set_timeout(runWorkerFrame, std::max(0.0, tWait_ms), nullptr);
 }
 
-EMSCRIPTEN_KEEPALIVE
-void set_mouse_down(int but, float x, float y) {
-    if (ignoreMouse) return;
+static void wakeWorker(void * ) {
+    isWakePending = false;
 
-    lastMouseDown[but] = true;
-    lastMousePos.x = x;
-    lastMousePos.y = y;
+    scheduleWorkerFrame();
 }
 
-EMSCRIPTEN_KEEPALIVE
-void set_mouse_up(int but, float x, float y) {
-    if (ignoreMouse) return;
+void ImTui_ImplEmscripten_RunInWorker(bool (*renderFrame)()) {
+    workerRenderFrame = renderFrame;
+    workerThread = pthread_self();
+    isRingEnabled = true;
 
-    lastMouseDown[but] = false;
-    lastMousePos.x = x;
-    lastMousePos.y = y;
+    runWorkerFrame(nullptr);
+
+    // keep the thread alive - from now on it only runs the timers, the wake-ups and the callbacks of the app
+    emscripten_exit_with_live_runtime();
 }
+#endif
 
-EMSCRIPTEN_KEEPALIVE
-void set_mouse_wheel(float x, float y) {
-    if (ignoreMouse) return;
+void ImTui_ImplEmscripten_RequestRedraw() {
+    nActiveFrames = 10;
+
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+    if (isRingEnabled) {
+        if (pthread_equal(pthread_self(), workerThread)) {
+            scheduleWorkerFrame();
+        } else if (isWakePending.exchange(true) == false) {
+            emscripten_proxy_async(emscripten_proxy_get_system_queue(), workerThread, wakeWorker, nullptr);
+        }
+        return;
+    }
+#endif
 
-    lastMouseWheelH = x;
-    lastMouseWheel  = y;
+    EM_ASM({
+        if (Module.requestFrame) Module.requestFrame();
+    });
 }
 
-EMSCRIPTEN_KEEPALIVE
-void get_screen(char * buffer) {
-    int nx = g_screen->nx;
-    int ny = g_screen->ny;
+void ImTui_ImplEmscripten_DrawScreen(bool active) {
+    const int nx = g_screen->nx;
+    const int ny = g_screen->ny;
 
-    int idx = 0;
+    bool compare = true;
+
+    if (screenPrev.nx != nx || screenPrev.ny != ny) {
+        screenPrev.resize(nx, ny);
+        compare = false;
+    }
+
+    dirtyRows.assign((ny + 31)/32, 0);
+    delta.clear();
+
+    bool isDirty = false;
     for (int y = 0; y < ny; ++y) {
-        for (int x = 0; x < nx; ++x) {
-            const auto & cell = g_screen->data[y*nx + x];
-            buffer[idx] = cell & 0x000000FF; ++idx;
-            buffer[idx] = (cell & 0x00FF0000) >> 16; ++idx;
-            buffer[idx] = (cell & 0xFF000000) >> 24; ++idx;
+        const ImTui::TCell * cur = g_screen->data + y*nx;
+        ImTui::TCell * prev = screenPrev.data + y*nx;
+
+        if (compare && memcmp(cur, prev, nx*sizeof(ImTui::TCell)) == 0) continue;
+
+        memcpy(prev, cur, nx*sizeof(ImTui::TCell));
+        dirtyRows[y/32] |= 1u << (y%32);
+        encodeRow(cur, nx, y, delta);
+        isDirty = true;
+    }
+
+    if (isDirty) {
+        ++frameSeq;
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+        if (isRingEnabled) {
+            publishFrame();
         }
+#endif
+    }
+
+    // something is still moving, e.g. scrolling
+    if (active || isDirty) {
+        nActiveFrames = 10;
+    } else if (nActiveFrames > 0) {
+        --nActiveFrames;
     }
 }
 
-EMSCRIPTEN_KEEPALIVE
-void set_key_down(int key) {
-    lastAddText[0] = 0;
-    lastAddText[1] = 0;
+static bool isSpecialKey(int key) {
+    for (int i = 0; i < ImGuiKey_COUNT; ++i) {
+        if (key == ImGui::GetIO().KeyMap[i] && key != ImGui::GetIO().KeyMap[ImGuiKey_Space]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// returns the character typed by the key, or 0
+static char applyKeyDown(int key) {
+    char res = 0;
 
     if (lastKeysDown[17]) {
         (key == 65) && (lastKeysDown[ImGui::GetIO().KeyMap[ImGuiKey_A]] = true);
@@ -146,20 +361,14 @@ void set_key_down(int key) {
         (key == 89) && (lastKeysDown[ImGui::GetIO().KeyMap[ImGuiKey_Y]] = true);
         (key == 90) && (lastKeysDown[ImGui::GetIO().KeyMap[ImGuiKey_Z]] = true);
     } else {
-        bool isSpecial = false;
-        for (int i = 0; i < ImGuiKey_COUNT; ++i) {
-            if (key == ImGui::GetIO().KeyMap[i] && key != ImGui::GetIO().KeyMap[ImGuiKey_Space]) {
-                isSpecial = true;
-                break;
-            }
-        }
+        const bool isSpecial = isSpecialKey(key);
 
         if (key == 189) { // minus '-' sign
             key = 45;
         }
 
         if (isSpecial == false) {
-            lastAddText[0] = key;
+            res = key;
         }
     }
 
@@ -176,10 +385,11 @@ void set_key_down(int key) {
     if (key == 18) {
         ImGui::GetIO().KeyAlt = true;
     }
+
+    return res;
 }
 
-EMSCRIPTEN_KEEPALIVE
-void set_key_up(int key) {
+static void applyKeyUp(int key) {
     lastKeysDown[key] = false;
 
     if (key == 16) {
@@ -201,16 +411,304 @@ void set_key_up(int key) {
     }
 }
 
+void ImTui_ImplEmscripten_NewFrame() {
+    // Apply the queued input in order. An event that would undo or reorder a change made in this frame - e.g. the
+    // release of a button that was just pressed, or a key after typed text - waits for the next frame, so that
+    // ImGui sees every step.
+    int buttonsChanged = 0;
+    bool isWheeled = false;
+    bool isTyped = false;
+    bool isSpecialKeyChanged = false;
+    bool isKeyDownText = false; // a printable key down is followed by a key press with the same char
+    std::bitset<512> keysChanged;
+
+    std::string text;
+
+    lastMouseWheelH = 0.0;
+    lastMouseWheel = 0.0;
+
+    tLastFrame_ms = emscripten_get_now();
+
+    std::vector<InputEvent> pending;
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        pending.swap(events);
+    }
+
+    size_t nApplied = 0;
+    for (const auto & event : pending) {
+        bool isDeferred = false;
+
+        switch (event.type) {
+            case InputEvent::MousePos:
+                {
+                    isDeferred = buttonsChanged != 0;
+                    if (isDeferred) break;
+
+                    lastMousePos = { event.x, event.y };
+                }
+                break;
+            case InputEvent::MouseDown:
+            case InputEvent::MouseUp:
+                {
+                    isDeferred = (buttonsChanged & (1 << event.key)) || isWheeled;
+                    if (isDeferred) break;
+
+                    lastMouseDown[event.key] = event.type == InputEvent::MouseDown;
+                    lastMousePos = { event.x, event.y };
+                    buttonsChanged |= 1 << event.key;
+                }
+                break;
+            case InputEvent::MouseWheel:
+                {
+                    isDeferred = buttonsChanged != 0;
+                    if (isDeferred) break;
+
+                    lastMouseWheelH += event.x;
+                    lastMouseWheel  += event.y;
+                    isWheeled = true;
+                }
+                break;
+            case InputEvent::KeyDown:
+            case InputEvent::KeyUp:
+                {
+                    const bool isSpecial = isSpecialKey(event.key);
+
+                    isDeferred = keysChanged[event.key] || (isSpecial && isTyped);
+                    if (isDeferred) break;
+
+                    keysChanged[event.key] = true;
+                    isSpecialKeyChanged |= isSpecial;
+
+                    if (event.type == InputEvent::KeyUp) {
+                        applyKeyUp(event.key);
+                        break;
+                    }
+
+                    const char ch = applyKeyDown(event.key);
+                    if (ch != 0) {
+                        text += ch;
+                        isTyped = true;
+                        isKeyDownText = true;
+                        ++nApplied;
+                        continue;
+                    }
+                }
+                break;
+            case InputEvent::KeyPress:
+                {
+                    isDeferred = (buttonsChanged != 0 || isSpecialKeyChanged) && isKeyDownText == false;
+                    if (isDeferred) break;
+
+                    if (isKeyDownText) {
+                        text.back() = event.key;
+                    } else {
+                        text += event.key;
+                    }
+                    isTyped = true;
+                }
+                break;
+            case InputEvent::ScreenSize:
+                {
+                    ImGui::GetIO().DisplaySize = { event.x, event.y };
+
+                    // the page rebuilds its rows - send all of them in the next frame
+                    screenPrev.resize(0, 0);
+                }
+                break;
+        }
+
+        if (isDeferred) break;
+
+        isKeyDownText = false;
+        ++nApplied;
+    }
+
+    // the rest of the input is applied in the next frames
+    if (nApplied < pending.size()) {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        events.insert(events.begin(), pending.begin() + nApplied, pending.end());
+        nActiveFrames = 10;
+    }
+
+    ImGui::GetIO().MousePos = lastMousePos;
+    ImGui::GetIO().MouseWheelH = lastMouseWheelH;
+    ImGui::GetIO().MouseWheel = lastMouseWheel;
+    ImGui::GetIO().MouseDown[0] = lastMouseDown[0];
+    ImGui::GetIO().MouseDown[1] = lastMouseDown[2]; // right-click in browser is 2
+    ImGui::GetIO().MouseDown[2] = lastMouseDown[1]; // scroll-click in browser is 1
+    ImGui::GetIO().MouseDown[3] = lastMouseDown[3];
+    ImGui::GetIO().MouseDown[4] = lastMouseDown[4];
+
+    for (const char ch : text) {
+        if ((ch & 0x80) == 0) {
+            ImGui::GetIO().AddInputCharacter(ch);
+        }
+    }
+
+    for (int i = 0; i < 512; ++i) {
+        ImGui::GetIO().KeysDown[i] = lastKeysDown[i];
+    }
+}
+
+static void pushEvent(const InputEvent & event) {
+    {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+
+        // the page reports moves that do not change the position
+        if (event.type == InputEvent::MousePos && event.x == lastInputMousePos.x && event.y == lastInputMousePos.y) {
+            return;
+        }
+
+        if (event.type == InputEvent::MousePos || event.type == InputEvent::MouseDown || event.type == InputEvent::MouseUp) {
+            lastInputMousePos = { event.x, event.y };
+        }
+
+        // only the last position of consecutive moves matters
+        if (event.type == InputEvent::MousePos && events.empty() == false && events.back().type == InputEvent::MousePos) {
+            events.back() = event;
+        } else {
+            events.push_back(event);
+        }
+    }
+
+    ImTui_ImplEmscripten_RequestRedraw();
+}
+
 EMSCRIPTEN_KEEPALIVE
-void set_key_press(int key) {
-    if (key > 0) {
-        lastAddText[0] = key;
-        lastAddText[1] = 0;
+void set_mouse_pos(float x, float y) {
+    if (ignoreMouse) return;
+
+    pushEvent({ InputEvent::MousePos, 0, x, y });
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_mouse_down(int but, float x, float y) {
+    if (ignoreMouse) return;
+    if (but < 0 || but >= 5) return;
+
+    pushEvent({ InputEvent::MouseDown, but, x, y });
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_mouse_up(int but, float x, float y) {
+    if (ignoreMouse) return;
+    if (but < 0 || but >= 5) return;
+
+    pushEvent({ InputEvent::MouseUp, but, x, y });
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_mouse_wheel(float x, float y) {
+    if (ignoreMouse) return;
+
+    pushEvent({ InputEvent::MouseWheel, 0, x, y });
+}
+
+EMSCRIPTEN_KEEPALIVE
+void get_screen(char * buffer) {
+    int nx = g_screen->nx;
+    int ny = g_screen->ny;
+
+    int idx = 0;
+    for (int y = 0; y < ny; ++y) {
+        for (int x = 0; x < nx; ++x) {
+            const auto & cell = g_screen->data[y*nx + x];
+            buffer[idx] = cell & 0x000000FF; ++idx;
+            buffer[idx] = (cell & 0x00FF0000) >> 16; ++idx;
+            buffer[idx] = (cell & 0xFF000000) >> 24; ++idx;
+        }
+    }
+}
+
+EMSCRIPTEN_KEEPALIVE
+ImTui::TCell * get_screen_data() {
+    return g_screen->data;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int get_screen_nx() {
+    return g_screen->nx;
+}
+
+EMSCRIPTEN_KEEPALIVE
+int get_screen_ny() {
+    return g_screen->ny;
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint32_t get_screen_frame() {
+    return frameSeq;
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint32_t * get_screen_dirty_rows() {
+    return dirtyRows.data();
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint8_t * get_screen_delta() {
+    return delta.data();
+}
+
+EMSCRIPTEN_KEEPALIVE
+int get_screen_delta_size() {
+    return delta.size();
+}
+
+EMSCRIPTEN_KEEPALIVE
+uint8_t * encode_screen(const ImTui::TCell * cells, int nx, int ny, int * size) {
+    encoded.clear();
+    for (int y = 0; y < ny; ++y) {
+        encodeRow(cells + y*nx, nx, y, encoded);
     }
+
+    *size = encoded.size();
+
+    return encoded.data();
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_key_down(int key) {
+    if (key < 0 || key >= 512) return;
+
+    pushEvent({ InputEvent::KeyDown, key, 0.0f, 0.0f });
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_key_up(int key) {
+    if (key < 0 || key >= 512) return;
+
+    pushEvent({ InputEvent::KeyUp, key, 0.0f, 0.0f });
+}
+
+EMSCRIPTEN_KEEPALIVE
+void set_key_press(int key) {
+    if (key <= 0 || key >= 128) return;
+
+    pushEvent({ InputEvent::KeyPress, key, 0.0f, 0.0f });
 }
 
 EMSCRIPTEN_KEEPALIVE
 void set_screen_size(int nx, int ny) {
-    ImGui::GetIO().DisplaySize.x = nx;
-    ImGui::GetIO().DisplaySize.y = ny;
+    pushEvent({ InputEvent::ScreenSize, 0, float(nx), float(ny) });
+}
+
+EMSCRIPTEN_KEEPALIVE
+int get_frame_delay_ms() {
+    if (nActiveFrames > 0) return 0;
+
+    // keep the text cursor blinking
+    if (ImGui::GetIO().WantTextInput) {
+        return tStepIdle_ms > 0.0f ? std::min(100, int(tStepIdle_ms)) : 100;
+    }
+
+    return tStepIdle_ms > 0.0f ? int(tStepIdle_ms) : -1;
+}
+
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+EMSCRIPTEN_KEEPALIVE
+void * get_frame_ring() {
+    return &frameRing;
 }
+#endif
@@ -0,0 +1,224 @@
+//
+// Checks the frame ring of the worker build (see get_frame_ring()): a pthread of the module renders frames with random
+// changes through ImTui_ImplEmscripten_RunInWorker(), while this script plays the page in the main thread the same
+// way as examples/hnterm/index-tmpl.html - it takes the fresh slot, paints its delta and reports the painted frame.
+// The page is slow at times, so that frames are skipped, and changes the screen size, so that frames go stale.
+// After every paint the page must show exactly the cells of the slot.
+//
+//   node tests/frame-ring.js build/bin/test-emscripten.js
+//
+
+const assert = require('assert');
+const path = require('path');
+
+const createModule = require(path.resolve(process.argv[2]));
+
+const kFrames = 300;
+const kTimeout_ms = 60000;
+const kSizes = [ [ 40, 12 ], [ 80, 25 ], [ 33, 7 ] ];
+
+let seed = 1;
+function random() {
+    seed = (seed*1103515245 + 12345) & 0x7FFFFFFF;
+    return seed/0x80000000;
+}
+
+function busyWait(ms) {
+    const tEnd = Date.now() + ms;
+    while (Date.now() < tEnd) {}
+}
+
+// the page
+let Module = null;
+let ring = 0;
+let ringFront = 2;
+let ringNeedsAllRows = false;
+let screenX = 0;
+let screenY = 0;
+let screen = null;
+let takenSeq = 0;
+let paintedSeq = 0;
+let isPaintRequested = false;
+
+const stats = { requests: 0, painted: 0, partial: 0, skipped: 0, stale: 0, resized: 0 };
+
+function setScreenSize(nx, ny) {
+    screenX = nx;
+    screenY = ny;
+    screen = new Int32Array(nx*ny).fill(-1);
+    ringNeedsAllRows = true;
+    Module._set_screen_size(nx, ny);
+    ++stats.resized;
+}
+
+// see countDeltaRows() in index-tmpl.html
+function countDeltaRows(heap, p, end) {
+    let nRows = 0;
+    let y = -1;
+    while (p < end) {
+        const row = heap[p] | (heap[p + 1] << 8);
+        if (row != y) {
+            y = row;
+            ++nRows;
+        }
+        p += 8 + (heap[p + 4] | (heap[p + 5] << 8));
+    }
+
+    return nRows;
+}
+
+// see paintDelta() in index-tmpl.html - returns the number of painted rows
+function paintDelta(heap, p, end) {
+    let nRows = 0;
+    let y = -1;
+    while (p < end) {
+        const row = heap[p] | (heap[p + 1] << 8);
+        const col = heap[p + 2] | (heap[p + 3] << 8);
+        const n = heap[p + 4] | (heap[p + 5] << 8);
+        const colors = (heap[p + 6] << 16) | (heap[p + 7] << 24);
+        p += 8;
+
+        assert.ok(row < screenY && col + n <= screenX, 'run outside of the screen');
+        if (row != y) {
+            y = row;
+            ++nRows;
+        }
+
+        for (let i = 0; i < n; ++i) {
+            screen[row*screenX + col + i] = colors | heap[p + i];
+        }
+        p += n;
+    }
+    assert.strictEqual(p, end);
+
+    return nRows;
+}
+
+function paintFrameRing() {
+    const heap32 = Module.HEAP32;
+    if ((Atomics.load(heap32, ring) & 4) == 0) {
+        return;
+    }
+
+    const front = Atomics.exchange(heap32, ring, ringFront) & 3;
+    assert.ok(front < 3 && front != ringFront, 'bad slot swap: ' + ringFront + ' -> ' + front);
+    ringFront = front;
+
+    // every fresh slot is newer than the previous one
+    const slot = ring + 2 + 6*ringFront;
+    const seq = heap32[slot] >>> 0;
+    assert.ok(seq > takenSeq, 'slot with frame ' + seq + ' after frame ' + takenSeq);
+    takenSeq = seq;
+
+    if (heap32[slot + 1] != screenX || heap32[slot + 2] != screenY) {
+        ++stats.stale;
+        return;
+    }
+
+    // the rows were cleared by a resize - a frame rendered before it can have the same size, but not all rows
+    const p = heap32[slot + 4];
+    const end = p + heap32[slot + 5];
+    if (ringNeedsAllRows) {
+        if (countDeltaRows(Module.HEAPU8, p, end) < screenY) {
+            ++stats.stale;
+            return;
+        }
+        ringNeedsAllRows = false;
+    }
+
+    if (paintDelta(Module.HEAPU8, p, end) < screenY) {
+        ++stats.partial;
+    }
+
+    const cells = heap32[slot + 3] >> 2;
+    for (let i = 0; i < screenX*screenY; ++i) {
+        const cell = heap32[cells + i];
+        const ch = cell & 0xFFFF;
+        const expected = (cell & 0xFFFF0000) | (ch > 10 && ch < 128 ? ch : 32);
+        assert.strictEqual(screen[i], expected, 'frame ' + seq + ': wrong cell ' + (i % screenX) + ', ' + Math.floor(i/screenX));
+    }
+
+    if (paintedSeq != 0 && seq > paintedSeq + 1) {
+        stats.skipped += seq - paintedSeq - 1;
+    }
+    paintedSeq = seq;
+    ++stats.painted;
+
+    Atomics.store(heap32, ring + 1, seq);
+}
+
+function onPaint() {
+    isPaintRequested = false;
+
+    // slow frames - the worker publishes more than one frame in the meantime
+    if (random() < 0.2) {
+        busyWait(50*random());
+    }
+
+    // change the size while frames are in flight, sometimes twice in a row, before the worker sees the first one
+    if (Module._is_publisher_done() == false && random() < 0.05) {
+        const size = kSizes[Math.floor(random()*kSizes.length)];
+        setScreenSize(size[0], size[1]);
+        if (random() < 0.3) {
+            const other = kSizes[Math.floor(random()*kSizes.length)];
+            setScreenSize(other[0], other[1]);
+            setScreenSize(size[0], size[1]);
+        }
+    }
+
+    paintFrameRing();
+}
+
+function requestFrame() {
+    ++stats.requests;
+    if (isPaintRequested == false) {
+        isPaintRequested = true;
+        setImmediate(onPaint);
+    }
+}
+
+createModule({ requestFrame: requestFrame }).then(function(instance) {
+    Module = instance;
+    ring = Module._get_frame_ring() >> 2;
+
+    setScreenSize(kSizes[0][0], kSizes[0][1]);
+    Module._start_publisher(kFrames);
+
+    const tStart = Date.now();
+    const timer = setInterval(function() {
+        try {
+            const isDone = Module._is_publisher_done() &&
+                paintedSeq == Module._get_publisher_seq() >>> 0 &&
+                (Atomics.load(Module.HEAP32, ring) & 4) == 0;
+
+            if (isDone == false) {
+                assert.ok(Date.now() - tStart < kTimeout_ms, 'timeout - ' + JSON.stringify(stats));
+                return;
+            }
+
+            clearInterval(timer);
+
+            console.log('frame-ring: ' + JSON.stringify(stats));
+
+            assert.ok(stats.requests > 0, 'Module.requestFrame() was never called');
+            assert.ok(stats.painted > 0, 'no frames painted');
+            assert.ok(stats.partial > 0, 'all frames had all rows - paintedSeq is not used');
+            assert.ok(stats.skipped > 0, 'no frames were skipped - the test does not cover them');
+            assert.ok(stats.resized > 1, 'the screen size never changed');
+
+            console.log('frame-ring: ok');
+            process.exit(0);
+        } catch (e) {
+            console.error(e);
+            process.exit(1);
+        }
+    }, 50);
+}).catch(function(e) {
+    console.error(e);
+    process.exit(1);
+});
+
+process.on('uncaughtException', function(e) {
+    console.error(e);
+    process.exit(1);
+});
@@ -0,0 +1,109 @@
+//
+// Checks the screen delta format of the Emscripten backend (see get_screen_delta()) through encode_screen():
+// the row/col/n fields, the merging of cells with the same colors into runs and the replacement of the characters
+// that the page cannot show.
+//
+//   node tests/screen-delta.js build/bin/test-emscripten.js
+//
+
+const assert = require('assert');
+const path = require('path');
+
+const createModule = require(path.resolve(process.argv[2]));
+
+function cell(ch, fg, bg) {
+    const c = typeof ch === 'string' ? ch.charCodeAt(0) : ch;
+    return ((bg << 24) | (fg << 16) | c) | 0;
+}
+
+function row(text, fg, bg) {
+    return Array.from(text, function(ch) { return cell(ch, fg, bg); });
+}
+
+// u16 row | u16 col | u16 n | u8 fg | u8 bg | n chars
+function decode(heap, p, end) {
+    const runs = [];
+    while (p < end) {
+        assert.ok(p + 8 <= end, 'truncated run header');
+        const n = heap[p + 4] | (heap[p + 5] << 8);
+        const run = {
+            row: heap[p] | (heap[p + 1] << 8),
+            col: heap[p + 2] | (heap[p + 3] << 8),
+            n: n,
+            fg: heap[p + 6],
+            bg: heap[p + 7],
+            text: '',
+        };
+        p += 8;
+        assert.ok(p + n <= end, 'truncated run');
+        for (let i = 0; i < n; ++i) {
+            run.text += String.fromCharCode(heap[p + i]);
+        }
+        p += n;
+        runs.push(run);
+    }
+    assert.strictEqual(p, end);
+    return runs;
+}
+
+createModule().then(function(Module) {
+    function encode(cells, nx, ny) {
+        assert.strictEqual(cells.length, nx*ny);
+        const pCells = Module._malloc(4*Math.max(1, cells.length));
+        const pSize = Module._malloc(4);
+        Module.HEAP32.set(cells, pCells >> 2);
+        const p = Module._encode_screen(pCells, nx, ny, pSize);
+        const runs = decode(Module.HEAPU8, p, p + Module.HEAP32[pSize >> 2]);
+        Module._free(pSize);
+        Module._free(pCells);
+        return runs;
+    }
+
+    // empty screen - empty stream
+    assert.deepStrictEqual(encode([], 0, 0), []);
+
+    // one row with a single color - one run
+    assert.deepStrictEqual(encode(row('hello', 7, 0), 5, 1), [
+        { row: 0, col: 0, n: 5, fg: 7, bg: 0, text: 'hello' },
+    ]);
+
+    // a change of fg or bg starts a new run at the right column
+    assert.deepStrictEqual(encode([].concat(row('ab', 1, 2), row('cd', 3, 2), row('ef', 3, 4), row('g', 1, 2)), 7, 1), [
+        { row: 0, col: 0, n: 2, fg: 1, bg: 2, text: 'ab' },
+        { row: 0, col: 2, n: 2, fg: 3, bg: 2, text: 'cd' },
+        { row: 0, col: 4, n: 2, fg: 3, bg: 4, text: 'ef' },
+        { row: 0, col: 6, n: 1, fg: 1, bg: 2, text: 'g' },
+    ]);
+
+    // runs never continue on the next row, even with the same colors
+    assert.deepStrictEqual(encode([].concat(row('abc', 5, 6), row('def', 5, 6), row('ghi', 255, 255)), 3, 3), [
+        { row: 0, col: 0, n: 3, fg: 5, bg: 6, text: 'abc' },
+        { row: 1, col: 0, n: 3, fg: 5, bg: 6, text: 'def' },
+        { row: 2, col: 0, n: 3, fg: 255, bg: 255, text: 'ghi' },
+    ]);
+
+    // characters the page cannot show become spaces, without splitting the run - also the ones outside of the first
+    // 256 whose low byte is printable (U+2541)
+    assert.deepStrictEqual(encode([0, 9, 10, 11, 'A', 127, 128, 0x2500, 0x2541].map(function(c) { return cell(c, 1, 0); }), 9, 1), [
+        { row: 0, col: 0, n: 9, fg: 1, bg: 0, text: '   \x0bA\x7f   ' },
+    ]);
+
+    // fields wider than a byte are little-endian
+    const nx = 300;
+    const wide = [];
+    for (let y = 0; y < 260; ++y) {
+        for (let x = 0; x < nx; ++x) {
+            wide.push(cell('x', x < 290 ? 1 : 2, 0));
+        }
+    }
+    const runs = encode(wide, nx, 260);
+    assert.strictEqual(runs.length, 2*260);
+    assert.deepStrictEqual(runs[2*259 + 1], { row: 259, col: 290, n: 10, fg: 2, bg: 0, text: 'x'.repeat(10) });
+    assert.strictEqual(runs[2*259].n, 290);
+
+    console.log('screen-delta: ok');
+    process.exit(0);
+}).catch(function(e) {
+    console.error(e);
+    process.exit(1);
+});
@@ -0,0 +1,83 @@
+/*! \file test-emscripten.cpp
+ *  \brief Module for the Node tests of the Emscripten backend - the tests call the exported functions directly
+ */
+
+#include "imtui/imtui.h"
+#include "imtui/imtui-impl-emscripten.h"
+
+#include <emscripten.h>
+
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+#include <atomic>
+#include <random>
+#include <thread>
+
+// A worker that renders frames with random changes - tests/frame-ring.js plays the page in the main thread
+static ImTui::TScreen * g_screen = nullptr;
+static int g_nFrames = 0;
+static std::atomic<int> g_nRendered { 0 };
+static std::atomic<uint32_t> g_lastSeq { 0 };
+
+static bool renderRandomFrame() {
+    static std::mt19937 rng(1);
+
+    ImTui_ImplEmscripten_NewFrame();
+
+    // the size comes from the page, see set_screen_size()
+    const auto & size = ImGui::GetIO().DisplaySize;
+    if (g_screen->nx != int(size.x) || g_screen->ny != int(size.y)) {
+        g_screen->resize(size.x, size.y);
+        g_screen->clear();
+    }
+
+    const bool isActive = g_nRendered < g_nFrames;
+    if (isActive && g_screen->size() > 0) {
+        for (int i = 0; i < 4; ++i) {
+            const ImTui::TCell ch = rng()%8 == 0 ? 0x2541 : 'a' + rng()%3;
+            g_screen->data[rng()%g_screen->size()] = (rng()%4) << 24 | (rng()%4) << 16 | ch;
+        }
+    }
+
+    ImTui_ImplEmscripten_DrawScreen(isActive);
+
+    g_lastSeq = get_screen_frame();
+    ++g_nRendered;
+
+    return true;
+}
+
+extern "C" {
+    EMSCRIPTEN_KEEPALIVE
+        void start_publisher(int nFrames) {
+            g_nFrames = nFrames;
+
+            std::thread([]() {
+                ImTui_ImplEmscripten_RunInWorker(renderRandomFrame);
+            }).detach();
+        }
+
+    // the sequence number of the last rendered frame, and if the random changes are over
+    EMSCRIPTEN_KEEPALIVE
+        uint32_t get_publisher_seq() {
+            return g_lastSeq;
+        }
+
+    EMSCRIPTEN_KEEPALIVE
+        bool is_publisher_done() {
+            return g_nRendered >= g_nFrames;
+        }
+}
+#endif
+
+int main() {
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+
+#ifdef IMTUI_EMSCRIPTEN_WORKER
+    g_screen = ImTui_ImplEmscripten_Init(false);
+#else
+    ImTui_ImplEmscripten_Init(false);
+#endif
+
+    return 0;
+}